@@ -0,0 +1,307 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <frc/geometry/Pose3d.h>
+#include <frc/geometry/Transform3d.h>
+#include <frc/geometry/Twist3d.h>
+#include <networktables/DoubleArrayTopic.h>
+#include <networktables/NetworkTableInstance.h>
+#include <networktables/RawTopic.h>
+#include <networktables/StructArrayTopic.h>
+#include <networktables/StructTopic.h>
+
+#include "LocalizerEstimateStruct.h"
+#include "TagDetectionStruct.h"
+#include "gtsam_utils.h"
+#include "localizer_runner.h"
+#include "replay.h"
+#include "synthetic.h"
+#include "worker_pool.h"
+
+using namespace gtsam;
+using namespace std::chrono_literals;
+
+// The whole gtsam-node path, over real NT: a client instance publishes what
+// robot code and the coprocessors would to an in-process server, and a
+// LocalizerRunner on the server instance reads it, optimizes and publishes
+// back. Per cycle we time from publishing one odometry update (plus any
+// frames due) to the client receiving the estimate that includes it, so
+// this counts NT serialization, queueing and the listeners on top of the
+// localizer itself.
+
+namespace {
+// Off the defaults, so a real server on this machine doesn't get in the way
+constexpr unsigned int kPort3 = 11735;
+constexpr unsigned int kPort4 = 15810;
+
+// Give up on a cycle's estimate after this long
+constexpr auto kCycleTimeout = 1s;
+
+// Same as CameraListener's optical axis fix, backwards
+const Pose3 kOpticalToWpilib =
+    Pose3{Rot3(0, 0, 1, -1, 0, 0, 0, -1, 0), Point3{}}.inverse();
+
+// Spin until done, or until the timeout
+bool WaitFor(const std::function<bool()> &done,
+             std::chrono::steady_clock::duration timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(100us);
+  }
+  return true;
+}
+
+/**
+ * Everything robot code and the coprocessors publish for one robot
+ */
+struct Inputs {
+  Inputs(nt::NetworkTableInstance inst, const std::string &root,
+         const SyntheticRun &run)
+      : odom(inst.GetStructTopic<frc::Twist3d>(root + "/input/odom_twist")
+                 .Publish({.sendAll = true, .keepDuplicates = true})),
+        initialGuess(inst.GetStructTopic<frc::Pose3d>(
+                             root + "/input/pose_initial_guess")
+                         .Publish({.sendAll = true})) {
+    for (size_t i = 0; i < run.cameras.size(); i++) {
+      const std::string cam = fmt::format("{}/cam{}/input/", root, i);
+      tags.push_back(
+          inst.GetStructArrayTopic<TagDetection>(cam + "tags")
+              .Publish({.sendAll = true, .keepDuplicates = true}));
+      robotTcam.push_back(
+          inst.GetStructTopic<frc::Transform3d>(cam + "robotTcam").Publish());
+      intrinsics.push_back(
+          inst.GetDoubleArrayTopic(cam + "cam_intrinsics").Publish());
+    }
+  }
+
+  nt::StructPublisher<frc::Twist3d> odom;
+  nt::StructPublisher<frc::Pose3d> initialGuess;
+  std::vector<nt::StructArrayPublisher<TagDetection>> tags;
+  std::vector<nt::StructPublisher<frc::Transform3d>> robotTcam;
+  std::vector<nt::DoubleArrayPublisher> intrinsics;
+};
+
+LocalizerConfig MakeConfig(const std::string &root, const SyntheticRun &run) {
+  LocalizerConfig config;
+  config.rootTableName = root;
+  config.rotNoise = {0.0087, 0.0087, 0.0087};
+  config.transNoise = {0.004, 0.004, 0.004};
+  for (size_t i = 0; i < run.cameras.size(); i++) {
+    CameraConfig camera;
+    camera.subtableName = fmt::format("cam{}", i);
+    camera.pixelNoise = run.pixelNoise;
+    config.cameras.push_back(camera);
+  }
+  // We send an initial guess
+  config.autoInitialize = false;
+  return config;
+}
+
+// The reference log, in the shape the synthetic generator makes
+SyntheticRun FromReplay(const ReplayLog &log, const ReplayCamera &camera) {
+  SyntheticRun run;
+  run.cameras.push_back(SyntheticCamera{
+      camera.K, static_cast<int>(2 * camera.K.px()),
+      static_cast<int>(2 * camera.K.py()), camera.robotTcamera});
+  run.pixelNoise = camera.pixelNoise;
+  run.odometry = log.odometry;
+  for (const auto &tags : log.tags) {
+    run.frames.push_back({tags.time, 0, tags.value});
+  }
+  // Start off where the robot thought it was
+  const frc::Translation2d start = log.reference.front().value;
+  run.truth.push_back({log.odometry.front().time,
+                       Pose3{Rot3{}, Point3{start.X().value(),
+                                            start.Y().value(), 0}}});
+  return run;
+}
+
+struct LoopbackStats {
+  // Odometry published -> estimate including it received
+  std::vector<double> endToEndMs;
+  // Each LocalizerRunner::Update() (and flush) while we waited
+  std::vector<double> updateMs;
+  // Cycles whose estimate never showed up
+  size_t timeouts = 0;
+};
+
+LoopbackStats RunLoopback(const SyntheticRun &run) {
+  // Fresh topics every run, so nothing retained from the last one leaks in
+  static std::atomic<int> runCount{0};
+  const std::string root = fmt::format("/loopback{}", runCount++);
+
+  // The node side has to be the default instance, that's what the listeners
+  // use
+  nt::NetworkTableInstance server = nt::NetworkTableInstance::GetDefault();
+  server.StopClient();
+  server.StartServer("", "127.0.0.1", kPort3, kPort4);
+
+  nt::NetworkTableInstance client = nt::NetworkTableInstance::Create();
+  client.SetServer("127.0.0.1", kPort4);
+  client.StartClient4("loopback-bench");
+
+  LoopbackStats stats;
+  if (!WaitFor([&] { return client.IsConnected(); }, 5s)) {
+    throw std::runtime_error("Loopback client never connected");
+  }
+
+  WorkerPool pool;
+  LocalizerRunner runner{MakeConfig(root, run), pool};
+
+  // Real-looking timestamps, so nothing downstream trips over tiny ones
+  const auto baseUs = static_cast<uint64_t>(nt::Now());
+
+  // Calibration first. The runner backs off for a second if it's not ready,
+  // so wait until the server has all of it before the first Update()
+  Inputs inputs{client, root, run};
+  for (size_t i = 0; i < run.cameras.size(); i++) {
+    const SyntheticCamera &camera = run.cameras[i];
+    const Pose3 rTc = camera.robotTcamera * kOpticalToWpilib;
+    const frc::Pose3d pose = GtsamToFrcPose3d(rTc);
+    inputs.robotTcam[i].Set(
+        frc::Transform3d{pose.Translation(), pose.Rotation()});
+    inputs.intrinsics[i].Set(std::vector<double>{
+        camera.K.fx(), camera.K.fy(), camera.K.px(), camera.K.py()});
+  }
+  inputs.initialGuess.Set(GtsamToFrcPose3d(run.truth.front().value),
+                          baseUs + run.truth.front().time);
+  client.Flush();
+
+  auto intrinsicsSeen =
+      server
+          .GetDoubleArrayTopic(fmt::format("{}/cam{}/input/cam_intrinsics",
+                                           root, run.cameras.size() - 1))
+          .Subscribe({});
+  auto guessSeen = server
+                       .GetStructTopic<frc::Pose3d>(
+                           root + "/input/pose_initial_guess")
+                       .Subscribe({});
+  if (!WaitFor([&] { return !intrinsicsSeen.Get().empty() &&
+                            guessSeen.GetAtomic().time != 0; },
+               5s)) {
+    throw std::runtime_error("Loopback server never got calibration");
+  }
+
+  nt::RawSubscriber estimateSub =
+      client.GetRawTopic(root + "/output/estimate")
+          .Subscribe(wpi::Struct<LocalizerEstimate>::GetTypeString(), {},
+                     {.pollStorage = 100, .sendAll = true});
+
+  auto frame = run.frames.begin();
+  for (const auto &odom : run.odometry) {
+    const auto start = std::chrono::steady_clock::now();
+
+    for (; frame != run.frames.end() && frame->timeUs <= odom.time; frame++) {
+      inputs.tags[frame->camera].Set(frame->tags, baseUs + frame->timeUs);
+    }
+    inputs.odom.Set(odom.value, baseUs + odom.time);
+    client.Flush();
+
+    // Timestamps pick up the client's clock offset estimate on the way, so
+    // allow some slop. Odometry is much further apart than this
+    const auto wantUs = static_cast<int64_t>(baseUs + odom.time) - 1000;
+    const bool received = WaitFor(
+        [&] {
+          const auto updateStart = std::chrono::steady_clock::now();
+          runner.Update();
+          server.Flush();
+          stats.updateMs.push_back(
+              std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - updateStart)
+                  .count());
+
+          bool done = false;
+          for (const auto &raw : estimateSub.ReadQueue()) {
+            if (raw.value.size() !=
+                wpi::Struct<LocalizerEstimate>::GetSize()) {
+              continue;
+            }
+            const auto est = wpi::UnpackStruct<LocalizerEstimate>(raw.value);
+            done |= est.timestampUs >= wantUs;
+          }
+          return done;
+        },
+        kCycleTimeout);
+
+    if (received) {
+      stats.endToEndMs.push_back(std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count());
+    } else {
+      stats.timeouts++;
+    }
+  }
+
+  client.StopClient();
+  nt::NetworkTableInstance::Destroy(client);
+  server.StopServer();
+
+  return stats;
+}
+} // namespace
+
+static void BM_Loopback(benchmark::State &state, const SyntheticRun &run) {
+  LoopbackStats stats;
+  for (auto _ : state) {
+    stats = RunLoopback(run);
+  }
+
+  state.counters["p50_ms"] = Percentile(stats.endToEndMs, 0.5);
+  state.counters["p99_ms"] = Percentile(stats.endToEndMs, 0.99);
+  state.counters["max_ms"] = Percentile(stats.endToEndMs, 1.0);
+  state.counters["update_p50_ms"] = Percentile(stats.updateMs, 0.5);
+  state.counters["update_p99_ms"] = Percentile(stats.updateMs, 0.99);
+  state.counters["timeouts"] = static_cast<double>(stats.timeouts);
+}
+
+static void BM_LoopbackSynthetic(benchmark::State &state) {
+  SyntheticConfig config;
+  config.numCameras = static_cast<int>(state.range(0));
+  config.durationS = 10;
+  BM_Loopback(state, GenerateSynthetic(config));
+}
+BENCHMARK(BM_LoopbackSynthetic)
+    ->ArgName("cameras")
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+
+static void BM_LoopbackReplay(benchmark::State &state) {
+  BM_Loopback(state, FromReplay(ReferenceLog(), kReferenceCamera));
+}
+BENCHMARK(BM_LoopbackReplay)->Unit(benchmark::kMillisecond)->Iterations(1);
@@ -0,0 +1,76 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <numeric>
+#include <string>
+
+#include "replay.h"
+
+using namespace gtsam;
+
+// Whole log per iteration. Reports the optimize latency distribution and how
+// far we ended up from the robot's own pose estimate
+
+static void BM_Replay(benchmark::State &state, std::string smoother,
+                      Isam2Config isam2 = {}) {
+  ReplayStats stats;
+  for (auto _ : state) {
+    stats = RunReplay(ReferenceLog(), smoother, kReferenceCamera, isam2);
+  }
+
+  state.counters["p50_ms"] = Percentile(stats.optimizeMs, 0.5);
+  state.counters["p95_ms"] = Percentile(stats.optimizeMs, 0.95);
+  state.counters["p99_ms"] = Percentile(stats.optimizeMs, 0.99);
+  state.counters["max_ms"] = Percentile(stats.optimizeMs, 1.0);
+
+  const double sumSq =
+      std::inner_product(stats.errorM.begin(), stats.errorM.end(),
+                         stats.errorM.begin(), 0.0);
+  state.counters["rms_err_m"] =
+      stats.errorM.empty() ? 0 : std::sqrt(sumSq / stats.errorM.size());
+  state.counters["p95_err_m"] = Percentile(stats.errorM, 0.95);
+}
+BENCHMARK_CAPTURE(BM_Replay, isam2, std::string{"isam2"})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+// Every ordering/factorization combination. The default above is
+// colamd/cholesky
+BENCHMARK_CAPTURE(BM_Replay, isam2_colamd_qr, std::string{"isam2"},
+                  Isam2Config{"colamd", "qr"})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+BENCHMARK_CAPTURE(BM_Replay, isam2_constrained_cholesky, std::string{"isam2"},
+                  Isam2Config{"constrained", "cholesky"})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+BENCHMARK_CAPTURE(BM_Replay, isam2_constrained_qr, std::string{"isam2"},
+                  Isam2Config{"constrained", "qr"})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+BENCHMARK_CAPTURE(BM_Replay, batch, std::string{"batch"})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <numeric>
+
+#include "replay.h"
+#include "synthetic.h"
+
+// Scaling curves on simulated data. Each run drives the same 20s of laps,
+// one cycle per odometry update; args are how many cameras, the most tags any
+// frame keeps (0 for all) and the odometry rate.
+//
+// cpu_load is CPU time over simulated time, so past 1 a core can't keep up
+// in real time
+
+static void BM_Synthetic(benchmark::State &state) {
+  SyntheticConfig config;
+  config.numCameras = static_cast<int>(state.range(0));
+  config.maxTagsPerFrame = static_cast<int>(state.range(1));
+  config.odomRateHz = static_cast<double>(state.range(2));
+  const SyntheticRun run = GenerateSynthetic(config);
+
+  SyntheticStats stats;
+  for (auto _ : state) {
+    stats = RunSynthetic(run);
+  }
+
+  state.counters["p50_ms"] = Percentile(stats.cycleMs, 0.5);
+  state.counters["p99_ms"] = Percentile(stats.cycleMs, 0.99);
+  state.counters["max_ms"] = Percentile(stats.cycleMs, 1.0);
+
+  const double cpuMs =
+      std::accumulate(stats.cpuMs.begin(), stats.cpuMs.end(), 0.0);
+  state.counters["cpu_load"] = cpuMs / (config.durationS * 1000);
+
+  state.counters["tags_per_cycle"] =
+      stats.cycleMs.empty()
+          ? 0
+          : static_cast<double>(stats.tagObservations) / stats.cycleMs.size();
+
+  const double sumSq =
+      std::inner_product(stats.errorM.begin(), stats.errorM.end(),
+                         stats.errorM.begin(), 0.0);
+  state.counters["rms_err_m"] =
+      stats.errorM.empty() ? 0 : std::sqrt(sumSq / stats.errorM.size());
+}
+BENCHMARK(BM_Synthetic)
+    ->ArgNames({"cameras", "tags", "odom_hz"})
+    // Cameras
+    ->Args({1, 0, 50})
+    ->Args({2, 0, 50})
+    ->Args({4, 0, 50})
+    ->Args({8, 0, 50})
+    // Tags per frame
+    ->Args({4, 1, 50})
+    ->Args({4, 2, 50})
+    ->Args({4, 4, 50})
+    // Odometry rate
+    ->Args({2, 0, 100})
+    ->Args({2, 0, 250})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
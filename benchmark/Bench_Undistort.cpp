@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "distortion.h"
+
+using namespace gtsam;
+
+namespace {
+// Roughly an OV9281 with a wide lens, 1280x800
+const Cal3_S2 kK(900, 900, 0, 640, 400);
+const DistortionCoefficients kDistortion{
+    .k1 = -0.3, .k2 = 0.1, .p1 = 0.001, .p2 = -0.0005, .k3 = -0.01};
+
+std::vector<Point2> RandomPixels(size_t n) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> u(0, 1280), v(0, 800);
+
+  std::vector<Point2> ret;
+  ret.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    ret.emplace_back(u(gen), v(gen));
+  }
+  return ret;
+}
+} // namespace
+
+// One frame's worth of corners (16 tags) per iteration
+
+static void BM_UndistortIterative(benchmark::State &state) {
+  const auto pixels = RandomPixels(64);
+  const int iterations = state.range(0);
+
+  for (auto _ : state) {
+    for (const auto &p : pixels) {
+      benchmark::DoNotOptimize(
+          UndistortIterative(kK, kDistortion, p, iterations));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * pixels.size());
+}
+// 5 is what cv::undistortPoints does by default
+BENCHMARK(BM_UndistortIterative)->Arg(5)->Arg(20);
+
+static void BM_UndistortLut(benchmark::State &state) {
+  const auto pixels = RandomPixels(64);
+  const UndistortionLut lut(kK, kDistortion, 1280, 800, state.range(0));
+
+  for (auto _ : state) {
+    for (const auto &p : pixels) {
+      benchmark::DoNotOptimize(lut.Lookup(p));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * pixels.size());
+  state.counters["table_kB"] = lut.SizeBytes() / 1024.0;
+}
+BENCHMARK(BM_UndistortLut)->Arg(2)->Arg(4)->Arg(8);
+
+static void BM_BuildUndistortLut(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        UndistortionLut(kK, kDistortion, 1280, 800, state.range(0)));
+  }
+}
+BENCHMARK(BM_BuildUndistortLut)->Arg(4)->Unit(benchmark::kMillisecond);
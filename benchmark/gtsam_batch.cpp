@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "batch_solver.h"
+#include "model_registry.h"
+#include "replay.h"
+
+using namespace gtsam;
+
+/**
+ * Smooth a whole robot log offline and write the keyframe trajectory out as
+ * csv, to compare the fixed-lag localizer's output against.
+ */
+int main(int argc, char **argv) {
+  if (argc != 4) {
+    fmt::println("Usage: {} <log.wpilog> <camera.json> <out.csv>", argv[0]);
+    return -1;
+  }
+
+  fmt::println("Loading {}", argv[1]);
+  const ReplayLog log = LoadReplayLog(argv[1]);
+  if (log.odometry.empty() || log.reference.empty()) {
+    fmt::println("No odometry or reference pose in that log?");
+    return -1;
+  }
+  // The log doesn't say how its camera was calibrated or mounted
+  const ReplayCamera camera = LoadReplayCamera(argv[2]);
+
+  // Same noise the replay benchmark runs the localizer with
+  ModelRegistry registry;
+  const SharedNoiseModel &odomNoise = registry.InternNoise(
+      (Vector(6) << 0.0087, 0.0087, 0.0087, 0.004, 0.004, 0.004).finished());
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2{camera.pixelNoise / camera.K.fx(),
+                                   camera.pixelNoise / camera.K.fy()});
+
+  std::vector<OdometryObservation> odometry;
+  odometry.reserve(log.odometry.size());
+  for (const auto &odom : log.odometry) {
+    const frc::Twist3d &twist = odom.value;
+    Vector6 eigenTwist;
+    eigenTwist << twist.rx.value(), twist.ry.value(), twist.rz.value(),
+        twist.dx.value(), twist.dy.value(), twist.dz.value();
+    odometry.push_back({odom.time, Pose3::Expmap(eigenTwist), &odomNoise});
+  }
+
+  std::vector<CameraVisionObservation> vision;
+  for (const auto &frame : log.tags) {
+    for (const TagDetection &tag : frame.value) {
+      std::vector<Point2> corners;
+      corners.reserve(tag.corners.size());
+      for (const auto &c : tag.corners) {
+        corners.push_back(camera.K.calibrate(Point2{c.first, c.second}));
+      }
+      vision.push_back({frame.time, tag.id, std::move(corners),
+                        camera.robotTcamera, &cameraNoise});
+    }
+  }
+
+  // Start off where the robot thought it was
+  const frc::Translation2d start = log.reference.front().value;
+  const Timestamped<Pose3WithNoise> prior{
+      log.odometry.front().time,
+      {Pose3{Rot3{}, Point3{start.X().value(), start.Y().value(), 0}},
+       noiseModel::Isotropic::Sigma(6, 1.0)}};
+
+  const BatchResult result = SolveBatch(prior, odometry, vision);
+  fmt::println("{} keyframes, {} factors", result.trajectory.size(),
+               result.numFactors);
+  fmt::println("Built in {:.0f}ms, solved in {:.0f}ms over {} iterations",
+               result.buildMs, result.solveMs, result.iterations);
+  fmt::println("Error {:.3f} -> {:.3f}", result.initialError,
+               result.finalError);
+
+  std::ofstream out{argv[3]};
+  if (!out) {
+    fmt::println("Cannot write {}", argv[3]);
+    return -1;
+  }
+  out << "time_us,x,y,z,qw,qx,qy,qz\n";
+  for (const auto &[time, pose] : result.trajectory) {
+    const Quaternion q = pose.rotation().toQuaternion();
+    out << fmt::format("{},{},{},{},{},{},{},{}\n", time, pose.x(), pose.y(),
+                       pose.z(), q.w(), q.x(), q.y(), q.z());
+  }
+  fmt::println("Wrote {}", argv[3]);
+
+  return 0;
+}
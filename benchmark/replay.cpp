@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "replay.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fmt/format.h>
+#include <wpi/DataLogReader.h>
+#include <wpi/MemoryBuffer.h>
+#include <wpi/json.h>
+
+#include "TagDetectionStruct.h"
+#include "localizer.h"
+#include "model_registry.h"
+
+using namespace gtsam;
+
+// The reference log came out of PhotonVision's sim camera, which defaults to
+// 960x720 with a 90 degree FOV. Mounted facing forwards, optical axis along
+// robot +x
+const ReplayCamera kReferenceCamera{
+    Cal3_S2(90, 960, 720),
+    Pose3{Rot3(0, 0, 1, -1, 0, 0, 0, -1, 0), Point3{0.5, 0, 0.5}},
+    2.0,
+};
+
+ReplayCamera LoadReplayCamera(std::string_view path) {
+  std::error_code ec;
+  std::unique_ptr<wpi::MemoryBuffer> fileBuffer =
+      wpi::MemoryBuffer::GetFile(path, ec);
+  if (fileBuffer == nullptr || ec) {
+    throw std::runtime_error(fmt::format("Cannot open file: {}", path));
+  }
+  const wpi::json json = wpi::json::parse(fileBuffer->GetCharBuffer());
+
+  const auto K = json.at("intrinsics").get<std::array<double, 4>>();
+  const auto R = json.at("rotation").get<std::array<double, 9>>();
+  const auto t = json.at("translation").get<std::array<double, 3>>();
+  return ReplayCamera{
+      Cal3_S2(K[0], K[1], 0, K[2], K[3]),
+      Pose3{Rot3(R[0], R[1], R[2], R[3], R[4], R[5], R[6], R[7], R[8]),
+            Point3{t[0], t[1], t[2]}},
+      json.at("pixelNoise").get<double>(),
+  };
+}
+
+ReplayLog LoadReplayLog(std::string_view path) {
+  std::error_code ec;
+  std::unique_ptr<wpi::MemoryBuffer> fileBuffer =
+      wpi::MemoryBuffer::GetFile(path, ec);
+  if (fileBuffer == nullptr || ec) {
+    throw std::runtime_error(fmt::format("Cannot open file: {}", path));
+  }
+
+  wpi::log::DataLogReader reader{std::move(fileBuffer)};
+  if (!reader.IsValid()) {
+    throw std::runtime_error(fmt::format("Not a wpilog: {}", path));
+  }
+
+  enum class Topic { kOdom, kTags, kX, kY };
+  std::map<int, Topic> entries;
+
+  ReplayLog ret;
+  // Reference X and Y show up separately, so pair each X with the latest Y
+  double lastY = 0;
+
+  for (const auto &record : reader) {
+    if (record.IsStart()) {
+      wpi::log::StartRecordData start;
+      if (!record.GetStartData(&start)) {
+        continue;
+      }
+      if (start.name.ends_with("/robot/odom")) {
+        entries[start.entry] = Topic::kOdom;
+      } else if (start.name.ends_with("/cam/tags")) {
+        entries[start.entry] = Topic::kTags;
+      } else if (start.name.ends_with("/SmartDashboard/Drive/X")) {
+        entries[start.entry] = Topic::kX;
+      } else if (start.name.ends_with("/SmartDashboard/Drive/Y")) {
+        entries[start.entry] = Topic::kY;
+      }
+      continue;
+    }
+    if (record.IsControl()) {
+      continue;
+    }
+
+    const auto it = entries.find(record.GetEntry());
+    if (it == entries.end()) {
+      continue;
+    }
+    const auto time = static_cast<uint64_t>(record.GetTimestamp());
+
+    switch (it->second) {
+    case Topic::kOdom: {
+      const auto raw = record.GetRaw();
+      if (raw.size() == wpi::Struct<frc::Twist3d>::GetSize()) {
+        ret.odometry.push_back(
+            {time, wpi::UnpackStruct<frc::Twist3d>(raw)});
+      }
+      break;
+    }
+    case Topic::kTags: {
+      const auto raw = record.GetRaw();
+      constexpr size_t size = wpi::Struct<TagDetection>::GetSize();
+      std::vector<TagDetection> tags;
+      for (size_t i = 0; i + size <= raw.size(); i += size) {
+        tags.push_back(wpi::UnpackStruct<TagDetection>(raw.subspan(i, size)));
+      }
+      ret.tags.push_back({time, std::move(tags)});
+      break;
+    }
+    case Topic::kX: {
+      double x;
+      if (record.GetDouble(&x)) {
+        ret.reference.push_back(
+            {time,
+             frc::Translation2d{units::meter_t{x}, units::meter_t{lastY}}});
+      }
+      break;
+    }
+    case Topic::kY:
+      record.GetDouble(&lastY);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+const ReplayLog &ReferenceLog() {
+  static const ReplayLog log = LoadReplayLog(REPLAY_LOG_PATH);
+  return log;
+}
+
+ReplayStats RunReplay(const ReplayLog &log, std::string_view smoother,
+                      const ReplayCamera &camera, const Isam2Config &isam2) {
+  ReplayStats stats;
+  if (log.odometry.empty() || log.reference.empty()) {
+    return stats;
+  }
+
+  ModelRegistry registry;
+  const SharedNoiseModel &odomNoise = registry.InternNoise(
+      (Vector(6) << 0.0087, 0.0087, 0.0087, 0.004, 0.004, 0.004).finished());
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2{camera.pixelNoise / camera.K.fx(),
+                                   camera.pixelNoise / camera.K.fy()});
+
+  Localizer localizer{{.smoother = std::string(smoother), .isam2 = isam2}};
+
+  // Start off where the robot thought it was
+  const frc::Translation2d start = log.reference.front().value;
+  localizer.Reset(
+      Pose3{Rot3{}, Point3{start.X().value(), start.Y().value(), 0}},
+      noiseModel::Isotropic::Sigma(6, 1.0), log.odometry.front().time);
+
+  auto tags = log.tags.begin();
+  auto reference = log.reference.begin();
+
+  for (const auto &odom : log.odometry) {
+    // Vision can only hang off states the smoother already has
+    for (; tags != log.tags.end() && tags->time <= localizer.GetLastOdomTime();
+         tags++) {
+      for (const TagDetection &tag : tags->value) {
+        std::vector<Point2> corners;
+        corners.reserve(tag.corners.size());
+        for (const auto &c : tag.corners) {
+          corners.push_back(camera.K.calibrate(Point2{c.first, c.second}));
+        }
+        localizer.AddTagObservation(CameraVisionObservation{
+            tags->time, tag.id, std::move(corners), camera.robotTcamera,
+            &cameraNoise});
+      }
+    }
+
+    const frc::Twist3d &twist = odom.value;
+    Vector6 eigenTwist;
+    eigenTwist << twist.rx.value(), twist.ry.value(), twist.rz.value(),
+        twist.dx.value(), twist.dy.value(), twist.dz.value();
+    localizer.AddOdometry(
+        OdometryObservation{odom.time, Pose3::Expmap(eigenTwist), &odomNoise});
+
+    localizer.Optimize();
+    stats.optimizeMs.push_back(localizer.GetLastOptimizeMs());
+
+    // Compare against the newest reference from no later than now
+    while (std::next(reference) != log.reference.end() &&
+           std::next(reference)->time <= odom.time) {
+      reference++;
+    }
+    const Pose3 est = localizer.GetLatestWorldToBody();
+    stats.errorM.push_back(std::hypot(est.x() - reference->value.X().value(),
+                                      est.y() - reference->value.Y().value()));
+  }
+
+  return stats;
+}
+
+double Percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  const auto idx = static_cast<size_t>(std::round(p * (values.size() - 1)));
+  return values[idx];
+}
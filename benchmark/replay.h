@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Cal3_S2.h>
+#include <gtsam/geometry/Pose3.h>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <frc/geometry/Translation2d.h>
+#include <frc/geometry/Twist3d.h>
+
+#include "TagDetection.h"
+#include "config.h"
+#include "gtsam_utils.h"
+
+/**
+ * Everything we replay out of a robot log
+ */
+struct ReplayLog {
+  // /robot/odom
+  std::vector<Timestamped<frc::Twist3d>> odometry;
+  // /cam/tags, corners in pixels
+  std::vector<Timestamped<std::vector<TagDetection>>> tags;
+  // What the robot thought its pose was (/SmartDashboard/Drive/X, Y)
+  std::vector<Timestamped<frc::Translation2d>> reference;
+};
+
+/**
+ * Read a .wpilog. Topics are matched by suffix, so NT: and plain datalog
+ * entries both work. Throws if the file can't be read.
+ */
+ReplayLog LoadReplayLog(std::string_view path);
+
+/**
+ * data/factor_graph_reference_1.wpilog, loaded the first time it's asked for
+ */
+const ReplayLog &ReferenceLog();
+
+/**
+ * The logs don't record calibration, so the replay gets told it
+ */
+struct ReplayCamera {
+  gtsam::Cal3_S2 K;
+  // robot->camera, opencv convention (z out the lens)
+  gtsam::Pose3 robotTcamera;
+  double pixelNoise;
+};
+
+// What the reference log was recorded with
+extern const ReplayCamera kReferenceCamera;
+
+/**
+ * Read a camera calibration from json, eg data/reference_camera.json:
+ * "intrinsics" [fx, fy, cx, cy] in pixels, robot->camera as a row-major
+ * "rotation" [9] and a "translation" [3] in m, and "pixelNoise". Throws if
+ * the file can't be read or is missing any of them.
+ */
+ReplayCamera LoadReplayCamera(std::string_view path);
+
+struct ReplayStats {
+  // Wall time of each Optimize()
+  std::vector<double> optimizeMs;
+  // Distance from our latest pose to the reference after each Optimize()
+  std::vector<double> errorM;
+};
+
+/**
+ * Feed a whole log through a fresh Localizer, optimizing after every
+ * odometry update like the node would
+ *
+ * @param smoother backend name, see MakeSmootherBackend
+ * @param isam2 only used by the isam2 backend
+ */
+ReplayStats RunReplay(const ReplayLog &log, std::string_view smoother,
+                      const ReplayCamera &camera,
+                      const Isam2Config &isam2 = {});
+
+/**
+ * p in [0, 1]. Sorts values
+ */
+double Percentile(std::vector<double> values, double p);
@@ -0,0 +1,280 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "synthetic.h"
+
+#include <gtsam/geometry/Point2.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <numbers>
+#include <random>
+#include <string>
+#include <utility>
+
+#include <frc/apriltag/AprilTagFieldLayout.h>
+
+#include "TagModel.h"
+#include "localizer.h"
+#include "model_registry.h"
+
+using namespace gtsam;
+
+namespace {
+// Tags further than this are too small to detect reliably
+constexpr double kMaxRangeM = 7;
+constexpr double kLapS = 15;
+// Odometry error, as a fraction of each twist component (wheel slip)
+constexpr double kOdomSlip = 0.05;
+
+// Camera optical axis along robot +x, see CameraListener
+const Rot3 kOptical{0, 0, 1, -1, 0, 0, 0, -1, 0};
+
+class Trajectory {
+public:
+  explicit Trajectory(const frc::AprilTagFieldLayout &layout)
+      : centerX(layout.GetFieldLength().value() / 2),
+        centerY(layout.GetFieldWidth().value() / 2), radiusX(centerX * 0.55),
+        radiusY(centerY * 0.55) {}
+
+  // Facing along the ellipse
+  Pose3 At(double t) const {
+    constexpr double w = 2 * std::numbers::pi / kLapS;
+    const double x = centerX + radiusX * std::cos(w * t);
+    const double y = centerY + radiusY * std::sin(w * t);
+    const double dx = -radiusX * w * std::sin(w * t);
+    const double dy = radiusY * w * std::cos(w * t);
+    return Pose3{Rot3::Yaw(std::atan2(dy, dx)), Point3{x, y, 0}};
+  }
+
+private:
+  double centerX;
+  double centerY;
+  double radiusX;
+  double radiusY;
+};
+
+std::vector<SyntheticCamera> MakeCameras(int count) {
+  std::vector<SyntheticCamera> cameras;
+  for (int i = 0; i < count; i++) {
+    const double yaw = 2 * std::numbers::pi * i / count;
+    // 0.3m out from the middle, 0.5m up, tilted up 15 degrees
+    cameras.push_back(SyntheticCamera{
+        Cal3_S2(90, 960, 720),
+        960,
+        720,
+        Pose3{Rot3::Yaw(yaw) * Rot3::Pitch(-15 * std::numbers::pi / 180) *
+                  kOptical,
+              Point3{0.3 * std::cos(yaw), 0.3 * std::sin(yaw), 0.5}},
+    });
+  }
+  return cameras;
+}
+
+uint64_t ToUs(double seconds) {
+  return static_cast<uint64_t>(std::llround(seconds * 1e6));
+}
+} // namespace
+
+SyntheticRun GenerateSynthetic(const SyntheticConfig &config) {
+  const frc::AprilTagFieldLayout &layout = TagModel::DefaultLayout();
+
+  SyntheticRun run;
+  run.cameras = MakeCameras(config.numCameras);
+  run.pixelNoise = config.pixelNoise;
+
+  const Trajectory trajectory{layout};
+  const TagModel tagModel{layout};
+  std::mt19937 gen{config.seed};
+  std::normal_distribution<double> unit{0, 1};
+  std::bernoulli_distribution frameDropped{config.frameDropout};
+  std::bernoulli_distribution tagDropped{config.tagDropout};
+
+  // Start a second in, timestamp 0 means "never" in a few places
+  constexpr double kStartS = 1;
+  const uint64_t startUs = ToUs(kStartS);
+  run.truth.push_back({startUs, trajectory.At(0)});
+
+  const uint64_t odomPeriodUs = ToUs(1 / config.odomRateHz);
+  for (uint64_t offsetUs = odomPeriodUs;
+       offsetUs <= ToUs(config.durationS); offsetUs += odomPeriodUs) {
+    const double t = offsetUs / 1e6;
+    const Pose3 pose = trajectory.At(t);
+    Vector6 twist = Pose3::Logmap(run.truth.back().value.between(pose));
+    for (int i = 0; i < 6; i++) {
+      twist[i] += kOdomSlip * std::abs(twist[i]) * unit(gen);
+    }
+
+    const uint64_t timeUs = startUs + offsetUs;
+    run.odometry.push_back(
+        {timeUs, frc::Twist3d{units::meter_t{twist[3]},
+                              units::meter_t{twist[4]},
+                              units::meter_t{twist[5]},
+                              units::radian_t{twist[0]},
+                              units::radian_t{twist[1]},
+                              units::radian_t{twist[2]}}});
+    run.truth.push_back({timeUs, pose});
+  }
+
+  // Cameras aren't synced, so spread their frames out over one period
+  const uint64_t cameraPeriodUs = ToUs(1 / config.cameraRateHz);
+  for (size_t c = 0; c < run.cameras.size(); c++) {
+    const SyntheticCamera &camera = run.cameras[c];
+    const uint64_t phaseUs = cameraPeriodUs * c / run.cameras.size();
+
+    for (uint64_t offsetUs = phaseUs + cameraPeriodUs;
+         offsetUs <= ToUs(config.durationS); offsetUs += cameraPeriodUs) {
+      if (frameDropped(gen)) {
+        continue;
+      }
+
+      const double t = offsetUs / 1e6;
+      const uint64_t timeUs = startUs + offsetUs;
+
+      const Pose3 worldTcamera = trajectory.At(t) * camera.robotTcamera;
+
+      // Everything in view, closest first
+      std::vector<std::pair<double, TagDetection>> visible;
+      for (const frc::AprilTag &tag : layout.GetTags()) {
+        const Pose3 worldTtag = *tagModel.WorldToTag(tag.ID);
+        const Point3 tagPcamera =
+            worldTtag.transformTo(worldTcamera.translation());
+        // Tags face +x, and can't be seen from behind
+        if (tagPcamera.x() <= 0 || tagPcamera.norm() > kMaxRangeM) {
+          continue;
+        }
+
+        TagDetection detection{tag.ID, {}};
+        for (const Point3 &worldPcorner : *tagModel.WorldToCorners(tag.ID)) {
+          const Point3 cameraPcorner = worldTcamera.transformTo(worldPcorner);
+          if (cameraPcorner.z() < 0.1) {
+            break;
+          }
+          const Point2 pixel = camera.K.uncalibrate(
+              Point2{cameraPcorner.x() / cameraPcorner.z(),
+                     cameraPcorner.y() / cameraPcorner.z()});
+          if (pixel.x() < 0 || pixel.x() >= camera.width || pixel.y() < 0 ||
+              pixel.y() >= camera.height) {
+            break;
+          }
+          detection.corners.emplace_back(
+              pixel.x() + config.pixelNoise * unit(gen),
+              pixel.y() + config.pixelNoise * unit(gen));
+        }
+        if (detection.corners.size() == 4) {
+          visible.emplace_back(tagPcamera.norm(), std::move(detection));
+        }
+      }
+      std::sort(visible.begin(), visible.end(),
+                [](const auto &a, const auto &b) { return a.first < b.first; });
+
+      SyntheticFrame frame{timeUs, c, {}};
+      for (auto &[distance, detection] : visible) {
+        if (config.maxTagsPerFrame > 0 &&
+            frame.tags.size() >= static_cast<size_t>(config.maxTagsPerFrame)) {
+          break;
+        }
+        if (!tagDropped(gen)) {
+          frame.tags.push_back(std::move(detection));
+        }
+      }
+      run.frames.push_back(std::move(frame));
+    }
+  }
+  std::stable_sort(run.frames.begin(), run.frames.end(),
+                   [](const SyntheticFrame &a, const SyntheticFrame &b) {
+                     return a.timeUs < b.timeUs;
+                   });
+
+  return run;
+}
+
+SyntheticStats RunSynthetic(const SyntheticRun &run, std::string_view smoother,
+                            const Isam2Config &isam2) {
+  SyntheticStats stats;
+  if (run.odometry.empty()) {
+    return stats;
+  }
+
+  ModelRegistry registry;
+  const SharedNoiseModel &odomNoise = registry.InternNoise(
+      (Vector(6) << 0.0087, 0.0087, 0.0087, 0.004, 0.004, 0.004).finished());
+  // Every camera has the same intrinsics
+  const Cal3_S2 &K = run.cameras.front().K;
+  const SharedNoiseModel &cameraNoise = registry.InternNoise(
+      Vector2{run.pixelNoise / K.fx(), run.pixelNoise / K.fy()});
+
+  Localizer localizer{{.smoother = std::string(smoother), .isam2 = isam2}};
+  localizer.Reset(run.truth.front().value,
+                  noiseModel::Isotropic::Sigma(6, 0.1),
+                  run.truth.front().time);
+
+  auto frame = run.frames.begin();
+  for (size_t i = 0; i < run.odometry.size(); i++) {
+    const auto wallStart = std::chrono::steady_clock::now();
+    const std::clock_t cpuStart = std::clock();
+
+    // Vision can only hang off states the smoother already has
+    for (; frame != run.frames.end() &&
+           frame->timeUs <= localizer.GetLastOdomTime();
+         frame++) {
+      const SyntheticCamera &camera = run.cameras[frame->camera];
+      for (const TagDetection &tag : frame->tags) {
+        std::vector<Point2> corners;
+        corners.reserve(tag.corners.size());
+        for (const auto &c : tag.corners) {
+          corners.push_back(camera.K.calibrate(Point2{c.first, c.second}));
+        }
+        localizer.AddTagObservation(CameraVisionObservation{
+            frame->timeUs, tag.id, std::move(corners), camera.robotTcamera,
+            &cameraNoise, static_cast<uint32_t>(frame->camera)});
+        stats.tagObservations++;
+      }
+    }
+
+    const frc::Twist3d &twist = run.odometry[i].value;
+    Vector6 eigenTwist;
+    eigenTwist << twist.rx.value(), twist.ry.value(), twist.rz.value(),
+        twist.dx.value(), twist.dy.value(), twist.dz.value();
+    localizer.AddOdometry(OdometryObservation{
+        run.odometry[i].time, Pose3::Expmap(eigenTwist), &odomNoise});
+
+    localizer.Optimize();
+
+    stats.cycleMs.push_back(std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - wallStart)
+                                .count());
+    stats.cpuMs.push_back(1000.0 * (std::clock() - cpuStart) /
+                          CLOCKS_PER_SEC);
+
+    // truth[0] is where we started, before any odometry
+    const Pose3 est = localizer.GetLatestWorldToBody();
+    stats.errorM.push_back(
+        (est.translation() - run.truth[i + 1].value.translation()).norm());
+  }
+
+  return stats;
+}
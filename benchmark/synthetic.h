@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Cal3_S2.h>
+#include <gtsam/geometry/Pose3.h>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <frc/geometry/Twist3d.h>
+
+#include "TagDetection.h"
+#include "config.h"
+#include "gtsam_utils.h"
+
+/**
+ * Knobs for a simulated robot driving laps of the field
+ */
+struct SyntheticConfig {
+  // Spread evenly around the robot, first one facing forwards
+  int numCameras = 2;
+  double cameraRateHz = 30;
+  double odomRateHz = 50;
+  // Most tags any one frame keeps, closest first. 0 for every visible tag
+  int maxTagsPerFrame = 0;
+  double pixelNoise = 1.0;
+  // Chance a whole frame, or one tag in a frame, goes missing
+  double frameDropout = 0.05;
+  double tagDropout = 0.05;
+  double durationS = 20;
+  uint32_t seed = 1;
+};
+
+struct SyntheticCamera {
+  gtsam::Cal3_S2 K;
+  int width;
+  int height;
+  // robot->camera, opencv convention (z out the lens)
+  gtsam::Pose3 robotTcamera;
+};
+
+struct SyntheticFrame {
+  // Capture time
+  uint64_t timeUs;
+  size_t camera;
+  // Corners in pixels, like a coprocessor would send them
+  std::vector<TagDetection> tags;
+};
+
+/**
+ * Everything a run produces, in the same shape the robot would send it
+ */
+struct SyntheticRun {
+  std::vector<SyntheticCamera> cameras;
+  double pixelNoise;
+  // Noisy twists between consecutive odometry timestamps
+  std::vector<Timestamped<frc::Twist3d>> odometry;
+  // Every camera's frames, by capture time
+  std::vector<SyntheticFrame> frames;
+  // Where the robot really was at each odometry timestamp
+  std::vector<Timestamped<gtsam::Pose3>> truth;
+};
+
+/**
+ * Drive an ellipse around the middle of the default (2024) field,
+ * projecting every visible tag into every camera. Deterministic for a given
+ * seed.
+ */
+SyntheticRun GenerateSynthetic(const SyntheticConfig &config);
+
+struct SyntheticStats {
+  // Wall time of each cycle: adding that cycle's odometry and vision, then
+  // Optimize()
+  std::vector<double> cycleMs;
+  // Process CPU time of each cycle, so it counts any helper threads too
+  std::vector<double> cpuMs;
+  // Distance from our latest pose to the truth after each cycle
+  std::vector<double> errorM;
+  // Tags that went into the localizer
+  size_t tagObservations = 0;
+};
+
+/**
+ * Feed a run through a fresh Localizer, one cycle per odometry update like
+ * the node would
+ *
+ * @param smoother backend name, see MakeSmootherBackend
+ */
+SyntheticStats RunSynthetic(const SyntheticRun &run,
+                            std::string_view smoother = "isam2",
+                            const Isam2Config &isam2 = {});
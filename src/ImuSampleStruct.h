@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <wpi/SymbolExports.h>
+#include <wpi/struct/Struct.h>
+
+#include "ImuSample.h"
+
+template <> struct WPILIB_DLLEXPORT wpi::Struct<ImuSample> {
+  static constexpr std::string_view GetTypeString() {
+    return "struct:ImuSample";
+  }
+  static constexpr size_t GetSize() { return 8 * 6; }
+  static constexpr std::string_view GetSchema() {
+    return "double gyroX;double gyroY;double gyroZ;double accelX;double "
+           "accelY;double accelZ";
+  }
+
+  static ImuSample Unpack(std::span<const uint8_t> data) {
+    return ImuSample{
+        wpi::UnpackStruct<double, 8 * 0>(data),
+        wpi::UnpackStruct<double, 8 * 1>(data),
+        wpi::UnpackStruct<double, 8 * 2>(data),
+        wpi::UnpackStruct<double, 8 * 3>(data),
+        wpi::UnpackStruct<double, 8 * 4>(data),
+        wpi::UnpackStruct<double, 8 * 5>(data),
+    };
+  }
+
+  static void Pack(std::span<uint8_t> data, const ImuSample &value) {
+    wpi::PackStruct<8 * 0>(data, value.gyroX);
+    wpi::PackStruct<8 * 1>(data, value.gyroY);
+    wpi::PackStruct<8 * 2>(data, value.gyroZ);
+    wpi::PackStruct<8 * 3>(data, value.accelX);
+    wpi::PackStruct<8 * 4>(data, value.accelY);
+    wpi::PackStruct<8 * 5>(data, value.accelZ);
+  }
+};
+
+static_assert(wpi::StructSerializable<ImuSample>);
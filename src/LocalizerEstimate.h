@@ -0,0 +1,50 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <frc/geometry/Pose3d.h>
+
+/**
+ * Everything about one optimized estimate, so robot code gets it all in a
+ * single NT message
+ */
+struct LocalizerEstimate {
+  // field->robot pose
+  frc::Pose3d pose;
+  // Upper triangle (row major) of the 6x6 pose covariance, in order
+  // [rx ry rz tx ty tz]
+  std::array<double, 21> covariance;
+  // capture time of the newest state, uS
+  int64_t timestampUs;
+  // gtsam key of the newest state
+  uint64_t stateKey;
+  // vision factors that went into this optimization
+  int32_t visionFactors;
+  // How long the optimization itself took, ms
+  double optimizeMs;
+};
@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <wpi/SymbolExports.h>
+#include <wpi/struct/Struct.h>
+
+#include <frc/geometry/Pose3d.h>
+
+#include "LocalizerEstimate.h"
+
+template <> struct WPILIB_DLLEXPORT wpi::Struct<LocalizerEstimate> {
+  static constexpr size_t kPoseOff = 0;
+  static constexpr size_t kCovOff =
+      kPoseOff + wpi::Struct<frc::Pose3d>::GetSize();
+  static constexpr size_t kTimeOff = kCovOff + 8 * 21;
+  static constexpr size_t kKeyOff = kTimeOff + 8;
+  static constexpr size_t kVisionOff = kKeyOff + 8;
+  static constexpr size_t kOptimizeOff = kVisionOff + 4;
+
+  static constexpr std::string_view GetTypeString() {
+    return "struct:LocalizerEstimate";
+  }
+  static constexpr size_t GetSize() { return kOptimizeOff + 8; }
+  static constexpr std::string_view GetSchema() {
+    return "Pose3d pose;double covariance[21];int64 timestampUs;uint64 "
+           "stateKey;int32 visionFactors;double optimizeMs";
+  }
+
+  static LocalizerEstimate Unpack(std::span<const uint8_t> data) {
+    LocalizerEstimate ret{
+        wpi::UnpackStruct<frc::Pose3d, kPoseOff>(data),
+        {},
+        wpi::UnpackStruct<int64_t, kTimeOff>(data),
+        wpi::UnpackStruct<uint64_t, kKeyOff>(data),
+        wpi::UnpackStruct<int32_t, kVisionOff>(data),
+        wpi::UnpackStruct<double, kOptimizeOff>(data),
+    };
+    for (size_t i = 0; i < ret.covariance.size(); i++) {
+      ret.covariance[i] =
+          wpi::UnpackStruct<double>(data.subspan(kCovOff + 8 * i));
+    }
+    return ret;
+  }
+
+  static void Pack(std::span<uint8_t> data, const LocalizerEstimate &value) {
+    wpi::PackStruct<kPoseOff>(data, value.pose);
+    for (size_t i = 0; i < value.covariance.size(); i++) {
+      wpi::PackStruct(data.subspan(kCovOff + 8 * i), value.covariance[i]);
+    }
+    wpi::PackStruct<kTimeOff>(data, value.timestampUs);
+    wpi::PackStruct<kKeyOff>(data, value.stateKey);
+    wpi::PackStruct<kVisionOff>(data, value.visionFactors);
+    wpi::PackStruct<kOptimizeOff>(data, value.optimizeMs);
+  }
+
+  static void ForEachNested(
+      std::invocable<std::string_view, std::string_view> auto fn) {
+    wpi::ForEachStructSchema<frc::Pose3d>(fn);
+  }
+};
+
+static_assert(wpi::StructSerializable<LocalizerEstimate>);
+static_assert(wpi::HasNestedStruct<LocalizerEstimate>);
@@ -48,27 +48,23 @@ map<int, Pose3> TagLayoutToMap(const frc::AprilTagFieldLayout &layout) {
   return worldTtags;
 }
 
-inline const frc::AprilTagFieldLayout kDefaultLayout{
-    frc::LoadAprilTagLayoutField(frc::AprilTagField::k2024Crescendo)};
-
-float width = 6.5 * 25.4 / 1000.0; // 6.5in wide tag
-vector<Point3> tagToCorners{
+const float width = 6.5 * 25.4 / 1000.0; // 6.5in wide tag
+const vector<Point3> tagToCorners{
     {0, -width / 2.0, -width / 2.0},
     {0, width / 2.0, -width / 2.0},
     {0, width / 2.0, width / 2.0},
     {0, -width / 2.0, width / 2.0},
 };
-
-map<int, Pose3> worldTtags; // = TagLayoutToMap(kDefaultLayout);
 } // namespace
 
-namespace TagModel {
+TagModel::TagModel(const frc::AprilTagFieldLayout &layout)
+    : worldTtags(TagLayoutToMap(layout)) {}
 
-void SetLayout(const frc::AprilTagFieldLayout &layout) {
+void TagModel::SetLayout(const frc::AprilTagFieldLayout &layout) {
   worldTtags = TagLayoutToMap(layout);
 }
 
-std::optional<vector<Point3>> WorldToCorners(int id) {
+std::optional<vector<Point3>> TagModel::WorldToCorners(int id) const {
   auto maybePose = worldTtags.find(id);
   if (maybePose == worldTtags.end()) {
     return std::nullopt;
@@ -82,4 +78,19 @@ std::optional<vector<Point3>> WorldToCorners(int id) {
 
   return out;
 }
-} // namespace TagModel
+
+std::optional<Pose3> TagModel::WorldToTag(int id) const {
+  auto maybePose = worldTtags.find(id);
+  if (maybePose == worldTtags.end()) {
+    return std::nullopt;
+  }
+  return maybePose->second;
+}
+
+const vector<Point3> &TagModel::TagToCorners() { return tagToCorners; }
+
+const frc::AprilTagFieldLayout &TagModel::DefaultLayout() {
+  static const frc::AprilTagFieldLayout kDefaultLayout{
+      frc::LoadAprilTagLayoutField(frc::AprilTagField::k2024Crescendo)};
+  return kDefaultLayout;
+}
@@ -35,7 +35,30 @@
 
 #include "TagDetection.h"
 
-namespace TagModel {
-void SetLayout(const frc::AprilTagFieldLayout &layout);
-std::optional<std::vector<gtsam::Point3>> WorldToCorners(int id);
-} // namespace TagModel
+/**
+ * World-frame tag corner locations for one field layout. Each Localizer owns
+ * its own, so several localizers in one process can run different layouts.
+ */
+class TagModel {
+public:
+  TagModel() = default;
+  explicit TagModel(const frc::AprilTagFieldLayout &layout);
+
+  void SetLayout(const frc::AprilTagFieldLayout &layout);
+  std::optional<std::vector<gtsam::Point3>> WorldToCorners(int id) const;
+  std::optional<gtsam::Pose3> WorldToTag(int id) const;
+
+  /**
+   * Corners in the tag's own frame, same order as WorldToCorners. The tag
+   * lies in its y-z plane, facing +x
+   */
+  static const std::vector<gtsam::Point3> &TagToCorners();
+
+  /**
+   * The 2024 Crescendo layout that ships with WPILib
+   */
+  static const frc::AprilTagFieldLayout &DefaultLayout();
+
+private:
+  std::map<int, gtsam::Pose3> worldTtags;
+};
@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "batch_solver.h"
+
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+
+#include <chrono>
+#include <limits>
+
+#include "input_queue.h"
+#include "localizer.h"
+#include "model_registry.h"
+
+using namespace gtsam;
+
+namespace {
+double MsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+} // namespace
+
+BatchResult SolveBatch(const Timestamped<Pose3WithNoise> &prior,
+                       const std::vector<OdometryObservation> &odometry,
+                       const std::vector<CameraVisionObservation> &vision,
+                       const BatchConfig &config,
+                       const frc::AprilTagFieldLayout &layout) {
+  BatchResult result;
+  const auto buildStart = std::chrono::steady_clock::now();
+
+  // Holds the keyframes' composed noise models, so has to outlive the
+  // localizer's factors
+  ModelRegistry registry;
+
+  // An ISAM2 pass that never marginalizes. It's what builds the factors, and
+  // it hands the batch solve a starting point that's already close. Nobody
+  // reads its diagnostics, which would re-check the whole log every keyframe
+  Localizer localizer{{.lagUs = std::numeric_limits<double>::infinity(),
+                       .reprojectionDiagnostics = false}};
+  localizer.SetTagLayout(layout);
+  localizer.Reset(prior.value.pose, prior.value.noise, prior.time);
+
+  auto nextVision = vision.begin();
+  // Vision older than the prior has nothing to hang off
+  while (nextVision != vision.end() && nextVision->timeUs < prior.time) {
+    nextVision++;
+  }
+
+  std::vector<OdometryObservation> run;
+  Pose3 sinceKeyframe;
+  uint64_t keyframeUs = prior.time;
+
+  const auto addKeyframe = [&]() {
+    localizer.AddOdometry(ComposeOdometry(run, registry));
+
+    // Everything up to the new keyframe now has a state to hang off
+    for (; nextVision != vision.end() &&
+           nextVision->timeUs <= localizer.GetLastOdomTime();
+         nextVision++) {
+      localizer.AddTagObservation(*nextVision);
+    }
+
+    localizer.Optimize();
+
+    keyframeUs = run.back().timeUs;
+    sinceKeyframe = Pose3{};
+    run.clear();
+  };
+
+  for (const auto &odom : odometry) {
+    if (odom.timeUs <= prior.time) {
+      continue;
+    }
+    run.push_back(odom);
+    sinceKeyframe = sinceKeyframe * odom.poseDelta;
+
+    if (sinceKeyframe.translation().norm() >= config.keyframeTrans ||
+        Rot3::Logmap(sinceKeyframe.rotation()).norm() >= config.keyframeRot ||
+        odom.timeUs - keyframeUs >= config.keyframeIntervalUs) {
+      addKeyframe();
+    }
+  }
+  if (!run.empty()) {
+    addKeyframe();
+  }
+  result.buildMs = MsSince(buildStart);
+
+  const SmootherBackend &smoother = localizer.GetSmoother();
+  // ISAM2 leaves null slots where factors were removed
+  NonlinearFactorGraph factors;
+  for (const auto &factor : smoother.Factors()) {
+    if (factor) {
+      factors.push_back(factor);
+    }
+  }
+  const Values initial = smoother.CalculateEstimate();
+  result.numFactors = factors.size();
+
+  // GTSAM eliminates independent subtrees of the elimination tree on its TBB
+  // workers. Nested dissection gives it a bushy tree to spread out, where
+  // COLAMD on a long chain of states gives it a stick
+  LevenbergMarquardtParams params;
+  params.linearSolverType = NonlinearOptimizerParams::MULTIFRONTAL_CHOLESKY;
+  params.orderingType = Ordering::METIS;
+  params.maxIterations = config.maxIterations;
+
+  const auto solveStart = std::chrono::steady_clock::now();
+  LevenbergMarquardtOptimizer optimizer{factors, initial, params};
+  const Values solved = optimizer.optimize();
+  result.solveMs = MsSince(solveStart);
+
+  result.initialError = factors.error(initial);
+  result.finalError = optimizer.error();
+  result.iterations = static_cast<int>(optimizer.iterations());
+
+  // States are keyed X(timeUs), so these come out oldest first
+  result.trajectory.reserve(smoother.Timestamps().size());
+  for (const auto &[key, time] : smoother.Timestamps()) {
+    result.trajectory.push_back(
+        {static_cast<uint64_t>(time), solved.at<Pose3>(key)});
+  }
+
+  return result;
+}
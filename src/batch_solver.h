@@ -0,0 +1,79 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Pose3.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <frc/apriltag/AprilTagFieldLayout.h>
+
+#include "TagModel.h"
+#include "gtsam_utils.h"
+
+/**
+ * Offline smoothing of a whole log, to get a reference trajectory to hold the
+ * real-time localizer up against.
+ */
+struct BatchConfig {
+  // Odometry is composed into one delta per keyframe. A new keyframe starts
+  // once the robot has moved this far (m) or turned this much (rad) since the
+  // last one, or this long (uS) has passed regardless
+  double keyframeTrans = 0.05;
+  double keyframeRot = 0.05;
+  uint64_t keyframeIntervalUs = 100 * 1000;
+  int maxIterations = 100;
+};
+
+struct BatchResult {
+  // Every keyframe, oldest first
+  std::vector<Timestamped<gtsam::Pose3>> trajectory;
+  size_t numFactors = 0;
+  // Total graph error before and after the batch solve
+  double initialError = 0;
+  double finalError = 0;
+  int iterations = 0;
+  // Wall time of the incremental pass that builds the graph (and our initial
+  // guess), and of the batch solve
+  double buildMs = 0;
+  double solveMs = 0;
+};
+
+/**
+ * Build the same odometry and vision factors a Localizer would over the whole
+ * log, keeping every keyframe, then solve all of it at once with
+ * Levenberg-Marquardt. Vision snaps to the nearest keyframe.
+ *
+ * @param prior where the robot started
+ * @param odometry sorted by time
+ * @param vision sorted by time, corners normalized like CameraListener does
+ */
+BatchResult
+SolveBatch(const Timestamped<Pose3WithNoise> &prior,
+           const std::vector<OdometryObservation> &odometry,
+           const std::vector<CameraVisionObservation> &vision,
+           const BatchConfig &config = {},
+           const frc::AprilTagFieldLayout &layout = TagModel::DefaultLayout());
@@ -24,10 +24,15 @@
 
 #include "camera_listener.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <networktables/NetworkTable.h>
 #include <networktables/NetworkTableInstance.h>
 
 #include "gtsam_utils.h"
+#include "input_queue.h"
+#include "model_registry.h"
 
 using std::vector;
 using namespace gtsam;
@@ -40,7 +45,8 @@ CameraListener::CameraListener(std::string rootTable, CameraConfig config)
                      config.subtableName + "/input/tags")
                  .Subscribe({},
                             {
-                                .pollStorage = 100,
+                                .pollStorage =
+                                    PollStorageFor(config.queueDepth),
                                 .sendAll = true,
                                 .keepDuplicates = true,
                             })),
@@ -64,8 +70,7 @@ CameraListener::CameraListener(std::string rootTable, CameraConfig config)
                              .pollStorage = 1,
                              .sendAll = false,
                              .keepDuplicates = false,
-                         })),
-      measurementNoise(noiseModel::Isotropic::Sigma(2, config.pixelNoise)) {}
+                         })) {}
 
 bool CameraListener::ReadyToOptimize() {
   // grab the latest camera cal
@@ -74,7 +79,7 @@ bool CameraListener::ReadyToOptimize() {
   if (last_K.time > 0) {
     // Update calibration!
     std::vector<double> K_ = last_K.value;
-    if (K_.size() != 4) {
+    if (K_.size() != 4 && K_.size() != 12) {
       fmt::println("Camera {}: K of odd size {}?", config.subtableName,
                    K_.size());
       return false;
@@ -83,9 +88,39 @@ bool CameraListener::ReadyToOptimize() {
     auto newK = Cal3_S2{K_[0], K_[1],
                         0, // no skew
                         K_[2], K_[3]};
-    if (!cameraK || !cameraK->equals(newK, 1e-6)) {
+    // and then optionally [k1 k2 p1 p2 k3 k4 k5 k6]
+    DistortionCoefficients newDistortion;
+    if (K_.size() == 12) {
+      newDistortion = {K_[4], K_[5], K_[6], K_[7],
+                       K_[8], K_[9], K_[10], K_[11]};
+    }
+
+    if (!cameraK || !cameraK->equals(newK, 1e-6) ||
+        distortion != newDistortion) {
       cameraK = newK;
+      distortion = newDistortion;
       cameraK->print("New camera calibration");
+
+      // Normalizing divides u by fx and v by fy, so our pixel noise scales
+      // the same way
+      measurementNoise = &ModelRegistry::GetDefault().InternNoise(
+          Vector2{config.pixelNoise / cameraK->fx(),
+                  config.pixelNoise / cameraK->fy()});
+
+      undistortLut.reset();
+      if (!distortion.IsZero()) {
+        int width = config.imageWidth > 0
+                        ? config.imageWidth
+                        : static_cast<int>(std::ceil(2 * cameraK->px()));
+        int height = config.imageHeight > 0
+                         ? config.imageHeight
+                         : static_cast<int>(std::ceil(2 * cameraK->py()));
+        undistortLut.emplace(*cameraK, distortion, width, height,
+                             config.undistortLutStep);
+        fmt::println("Camera {}: built {}x{} undistortion table ({} kB)",
+                     config.subtableName, width, height,
+                     undistortLut->SizeBytes() / 1024);
+      }
     }
   }
   if (!cameraK) {
@@ -117,7 +152,10 @@ bool CameraListener::ReadyToOptimize() {
 }
 
 std::vector<CameraVisionObservation> CameraListener::Update() {
-  const auto tags = tagSub.ReadQueue();
+  auto tags = tagSub.ReadQueue();
+  droppedFrames += DropOldest(tags, std::max(0, config.queueDepth));
+  // Every frame in the batch was read now, whenever it actually arrived
+  const auto readUs = static_cast<uint64_t>(nt::Now());
 
   std::vector<CameraVisionObservation> ret;
   ret.reserve(tags.size());
@@ -129,13 +167,35 @@ std::vector<CameraVisionObservation> CameraListener::Update() {
       vector<Point2> cornersForGtsam;
       cornersForGtsam.reserve(4);
       for (const auto &c : t.corners) {
-        cornersForGtsam.emplace_back(c.first, c.second);
+        // Pixels -> normalized image coordinates, once, here
+        cornersForGtsam.push_back(NormalizeCorner(Point2{c.first, c.second}));
       }
 
-      ret.emplace_back(tarr.time, t.id, cornersForGtsam, *cameraK,
-                       *robotTcamera, measurementNoise);
+      // cameraIndex is left for the runner, which knows our config order
+      ret.push_back({
+          .timeUs = static_cast<uint64_t>(tarr.time),
+          .tagID = t.id,
+          .corners = std::move(cornersForGtsam),
+          .robotTcamera = *robotTcamera,
+          .cameraNoise = measurementNoise,
+          .readUs = readUs,
+      });
     }
   }
 
   return ret;
 }
+
+Point2 CameraListener::NormalizeCorner(const Point2 &pixel) const {
+  if (!undistortLut) {
+    // pixels are already undistorted
+    return cameraK->calibrate(pixel);
+  }
+
+  if (const auto normalized = undistortLut->Lookup(pixel)) {
+    return *normalized;
+  }
+
+  // Off the edge of the table (bad image size config?), do it the slow way
+  return UndistortIterative(*cameraK, distortion, pixel);
+}
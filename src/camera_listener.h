@@ -28,6 +28,7 @@
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/linear/NoiseModel.h>
 
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <vector>
@@ -40,7 +41,9 @@
 
 #include "TagDetectionStruct.h"
 #include "config.h"
+#include "distortion.h"
 #include "gtsam_utils.h"
+#include "model_registry.h"
 
 class CameraListener {
 public:
@@ -57,9 +60,25 @@ public:
    */
   std::vector<CameraVisionObservation> Update();
 
+  /**
+   * Tag frames thrown away because more than queueDepth arrived in one
+   * cycle. Cumulative
+   */
+  int64_t DroppedFrames() const { return droppedFrames; }
+
 private:
-  // Camera (pinhole) calibration coefficients
+  /**
+   * Pixel corner -> undistorted, normalized image coordinates
+   */
+  gtsam::Point2 NormalizeCorner(const gtsam::Point2 &pixel) const;
+
+  // Camera (pinhole) calibration coefficients. Only used to normalize corners
+  // as they come in, factors never see this
   std::optional<gtsam::Cal3_S2> cameraK;
+  // Lens distortion, all zero if the camera sent pinhole-only intrinsics
+  DistortionCoefficients distortion;
+  // Rebuilt whenever cameraK or distortion change. Empty if no distortion
+  std::optional<UndistortionLut> undistortLut;
   // Camera offset
   std::optional<::gtsam::Pose3> robotTcamera;
 
@@ -69,8 +88,14 @@ private:
   nt::StructArraySubscriber<TagDetection> tagSub;
   // Robot->this particular camera
   nt::StructSubscriber<frc::Transform3d> robotTcamSub;
-  // Camera calibration; assume all pixel inputs are already undistorted
+  // Camera calibration, either [fx fy cx cy] for pre-undistorted pixels, or
+  // [fx fy cx cy k1 k2 p1 p2 k3 k4 k5 k6] if we should undistort them
   nt::DoubleArraySubscriber pinholeIntrinsicsSub;
 
-  ::gtsam::noiseModel::Isotropic::shared_ptr measurementNoise;
+  // Pixel noise scaled into normalized image coordinates, so it depends on
+  // cameraK. Interned, so shared by every factor from this camera. Null until
+  // we get intrinsics
+  const ::gtsam::SharedNoiseModel *measurementNoise = nullptr;
+
+  int64_t droppedFrames = 0;
 };
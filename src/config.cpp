@@ -27,18 +27,38 @@
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
+#include <stdexcept>
 #include <system_error>
 
 #include <wpi/MemoryBuffer.h>
 #include <wpi/json.h>
 
 void LocalizerConfig::print(std::string_view prefix) {
-  fmt::println("{} root={}, rot={}, trans={}, cameras=[{}]", prefix,
-               rootTableName, fmt::join(rotNoise, ", "),
-               fmt::join(transNoise, ", "), fmt::join(cameras, ", "));
+  fmt::println("{} root={}, rot={}, trans={}, cameras=[{}], reorder={}ms{}, "
+               "engine={}, smoother={}{}, vision={}, autoInit={}, "
+               "odomQueue={} ({}), maxTags={}",
+               prefix, rootTableName, fmt::join(rotNoise, ", "),
+               fmt::join(transNoise, ", "), fmt::join(cameras, ", "),
+               reorderWindowMs, reorderOdometry ? " (+odom)" : "", engine,
+               smoother, planar ? " (planar)" : "", visionFactors,
+               autoInitialize, odomQueueDepth, odomOverflow,
+               loadShedding.maxTags);
 }
 
-LocalizerConfig ParseConfig(std::string_view path) {
+void NodeConfig::print(std::string_view prefix) {
+  fmt::println("{} server={}, workers={}, robots={}", prefix, ntServerURI,
+               workerThreads, robots.size());
+  fmt::println("{} main cpus=[{}], worker cpus=[{}], fifo={}, nice={}, "
+               "mlock={}",
+               prefix, fmt::join(realtime.mainCpus, ","),
+               fmt::join(realtime.workerCpus, ","), realtime.fifoPriority,
+               realtime.nice, realtime.lockMemory);
+  for (auto &robot : robots) {
+    robot.print("  ");
+  }
+}
+
+static wpi::json LoadJson(std::string_view path) {
   std::error_code ec;
   std::unique_ptr<wpi::MemoryBuffer> fileBuffer =
       wpi::MemoryBuffer::GetFile(path, ec);
@@ -46,17 +66,127 @@ LocalizerConfig ParseConfig(std::string_view path) {
     throw std::runtime_error(fmt::format("Cannot open file: {}", path));
   }
 
-  wpi::json json = wpi::json::parse(fileBuffer->GetCharBuffer());
+  return wpi::json::parse(fileBuffer->GetCharBuffer());
+}
+
+LocalizerConfig ParseConfig(std::string_view path) {
+  return LoadJson(path).get<LocalizerConfig>();
+}
+
+NodeConfig ParseNodeConfig(std::string_view path) {
+  wpi::json json = LoadJson(path);
 
-  return LocalizerConfig{
-      .rootTableName = json.at("rootTableName").get<std::string>(),
+  if (!json.contains("robots")) {
+    LocalizerConfig robot = json.get<LocalizerConfig>();
+    return NodeConfig{.ntServerURI = robot.ntServerURI,
+                      .workerThreads = json.value("workerThreads", 0),
+                      .realtime = json.value("realtime", RealtimeConfig{}),
+                      .robots = {robot}};
+  }
+
+  NodeConfig config{
       .ntServerURI = json.at("ntServerURI").get<std::string>(),
-      .rotNoise = json.at("rotNoise").get<std::array<double, 3>>(),
-      .transNoise = json.at("transNoise").get<std::array<double, 3>>(),
-      .cameras = json.at("cameras").get<std::vector<CameraConfig>>()};
+      .workerThreads = json.value("workerThreads", 0),
+      .realtime = json.value("realtime", RealtimeConfig{}),
+  };
+  for (wpi::json robot : json.at("robots")) {
+    // Robots all share the node's server unless they say otherwise
+    if (!robot.contains("ntServerURI")) {
+      robot["ntServerURI"] = config.ntServerURI;
+    }
+    config.robots.push_back(robot.get<LocalizerConfig>());
+  }
+
+  return config;
+}
+
+void from_json(const wpi::json &json, LocalizerConfig &config) {
+  config.rootTableName = json.at("rootTableName").get<std::string>();
+  config.ntServerURI = json.at("ntServerURI").get<std::string>();
+  config.rotNoise = json.at("rotNoise").get<std::array<double, 3>>();
+  config.transNoise = json.at("transNoise").get<std::array<double, 3>>();
+  config.cameras = json.at("cameras").get<std::vector<CameraConfig>>();
+  config.reorderWindowMs = json.value("reorderWindowMs", 0.0);
+  config.reorderOdometry = json.value("reorderOdometry", false);
+  config.engine = json.value("engine", std::string{"graph"});
+  config.smoother = json.value("smoother", std::string{"isam2"});
+  config.visionFactors = json.value("visionFactors", std::string{"corners"});
+  config.reprojectionDiagnostics = json.value("reprojectionDiagnostics", true);
+  config.autoInitialize = json.value("autoInitialize", true);
+  config.odomQueueDepth = json.value("odomQueueDepth", 100);
+  config.odomOverflow = json.value("odomOverflow", std::string{"coalesce"});
+  if (json.contains("imu")) {
+    config.imu = json.at("imu").get<ImuConfig>();
+  }
+  if (json.contains("isam2")) {
+    config.isam2 = json.at("isam2").get<Isam2Config>();
+  }
+  if (json.contains("planar")) {
+    config.planar = json.at("planar").get<PlanarConfig>();
+  }
+  if (json.contains("trajectory")) {
+    config.trajectory = json.at("trajectory").get<TrajectoryConfig>();
+  }
+  if (json.contains("loadShedding")) {
+    config.loadShedding = json.at("loadShedding").get<LoadSheddingConfig>();
+  }
+}
+
+void from_json(const wpi::json &json, ImuConfig &config) {
+  config.gyroNoiseDensity = json.value("gyroNoiseDensity", 0.0002);
+  config.gyroBias = json.value("gyroBias", std::array<double, 3>{0, 0, 0});
+  config.robotRimu = json.value("robotRimu", std::array<double, 3>{0, 0, 0});
+  config.queueDepth = json.value("queueDepth", 1000);
+}
+
+void from_json(const wpi::json &json, TrajectoryConfig &config) {
+  config.transThreshold = json.value("transThreshold", 0.01);
+  config.rotThreshold = json.value("rotThreshold", 0.01);
+  config.keyframeInterval = json.value("keyframeInterval", 20);
+}
+
+void from_json(const wpi::json &json, Isam2Config &config) {
+  config.ordering = json.value("ordering", std::string{"colamd"});
+  config.factorization = json.value("factorization", std::string{"cholesky"});
+  config.sparsifyMarginals = json.value("sparsifyMarginals", false);
+}
+
+void from_json(const wpi::json &json, PlanarConfig &config) {
+  config.height = json.value("height", 0.0);
+  config.roll = json.value("roll", 0.0);
+  config.pitch = json.value("pitch", 0.0);
+}
+
+void from_json(const wpi::json &json, LoadSheddingConfig &config) {
+  config.maxTags = json.value("maxTags", 0);
+  config.pendingBudget = json.value("pendingBudget", 0);
+  config.optimizeBudgetMs = json.value("optimizeBudgetMs", 0.0);
+}
+
+void from_json(const wpi::json &json, RealtimeConfig &config) {
+  config.mainCpus = json.value("mainCpus", std::vector<int>{});
+  config.workerCpus = json.value("workerCpus", std::vector<int>{});
+  config.fifoPriority = json.value("fifoPriority", 0);
+  config.nice = json.value("nice", 0);
+  config.lockMemory = json.value("lockMemory", false);
 }
 
 void from_json(const wpi::json &json, CameraConfig &config) {
   config.subtableName = json.at("subtableName").get<std::string>();
   config.pixelNoise = json.at("pixelNoise").get<double>();
+  config.imageWidth = json.value("imageWidth", 0);
+  config.imageHeight = json.value("imageHeight", 0);
+  config.undistortLutStep = json.value("undistortLutStep", 4.0);
+  if (config.imageWidth < 0 || config.imageHeight < 0) {
+    throw std::runtime_error(
+        fmt::format("Camera {}: negative image size {}x{}", config.subtableName,
+                    config.imageWidth, config.imageHeight));
+  }
+  // Not > 0 so NaN fails too
+  if (!(config.undistortLutStep > 0)) {
+    throw std::runtime_error(
+        fmt::format("Camera {}: undistortLutStep must be positive, got {}",
+                    config.subtableName, config.undistortLutStep));
+  }
+  config.queueDepth = json.value("queueDepth", 100);
 }
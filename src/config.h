@@ -28,6 +28,7 @@
 #include <fmt/ranges.h>
 
 #include <array>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,87 @@ struct CameraConfig {
   std::string subtableName;
 
   double pixelNoise;
+
+  // Image size, only needed to size the undistortion table when
+  // cam_intrinsics include distortion. 0 means guess from 2 * [cx cy]
+  int imageWidth = 0;
+  int imageHeight = 0;
+  // Undistortion table grid spacing, in pixels
+  double undistortLutStep = 4;
+  // Most tag frames to take off NT each cycle. Past that the oldest are
+  // dropped. 0 is unbounded
+  int queueDepth = 100;
+};
+
+struct ImuConfig {
+  // Gyro white noise density, rad/s/sqrt(Hz)
+  double gyroNoiseDensity = 0.0002;
+  // Fixed gyro bias, subtracted from every reading, rad/s
+  std::array<double, 3> gyroBias{0, 0, 0};
+  // Robot->IMU rotation as roll, pitch, yaw, rad
+  std::array<double, 3> robotRimu{0, 0, 0};
+  // Most readings to hold waiting for the odometry that closes their
+  // interval. Past that the oldest are dropped
+  int queueDepth = 1000;
+};
+
+struct Isam2Config {
+  // "colamd" leaves the ordering to ISAM2, apart from putting states about to
+  // be marginalized first. "constrained" also puts the newest states last,
+  // so they stay at the root of the Bayes tree
+  std::string ordering = "colamd";
+  // "cholesky" or "qr"
+  std::string factorization = "cholesky";
+  // Replace the dense factor marginalization leaves on the oldest states with
+  // a chain of pose priors, so it doesn't fill in the Bayes tree
+  bool sparsifyMarginals = false;
+};
+
+struct PlanarConfig {
+  // Where the robot frame sits above the floor, m, and how it's tilted
+  // relative to it, rad. Fixed for every state
+  double height = 0;
+  double roll = 0;
+  double pitch = 0;
+};
+
+struct TrajectoryConfig {
+  // Resend an old pose once the smoother has moved it more than this, m/rad
+  double transThreshold = 0.01;
+  double rotThreshold = 0.01;
+  // Send the whole history every this many messages, so late subscribers can
+  // sync up
+  int keyframeInterval = 20;
+};
+
+struct LoadSheddingConfig {
+  // Most tag observations one cycle adds once we're overloaded, picked by how
+  // much they'd tell us. 0 never sheds
+  int maxTags = 0;
+  // We're overloaded if a cycle brings more tag observations than this (0 for
+  // maxTags)...
+  int pendingBudget = 0;
+  // ...or the last optimize took longer than this, ms (0 to ignore)
+  double optimizeBudgetMs = 0;
+};
+
+/**
+ * How the node's threads get scheduled. Everything defaults to leaving it to
+ * the OS
+ */
+struct RealtimeConfig {
+  // Cores the main loop thread may run on. Empty for any
+  std::vector<int> mainCpus;
+  // Cores the worker pool (and GTSAM's TBB workers) may run on. Empty for
+  // any
+  std::vector<int> workerCpus;
+  // SCHED_FIFO priority (1-99) for the main and worker threads. 0 leaves
+  // them on the normal scheduler
+  int fifoPriority = 0;
+  // Nice value for the main and worker threads, if not SCHED_FIFO
+  int nice = 0;
+  // mlockall() once everything's set up, so we never page fault mid-cycle
+  bool lockMemory = false;
 };
 
 struct LocalizerConfig {
@@ -51,12 +133,92 @@ struct LocalizerConfig {
   // cameras
   std::vector<CameraConfig> cameras;
 
+  // How long to hold vision observations so late frames can be sorted in
+  // with their neighbours and added in one batch. 0 disables
+  double reorderWindowMs = 0;
+  // Hold odometry for the same window too. Late vision then lands on states
+  // that haven't been committed to the smoother yet, at the cost of our
+  // output pose lagging by the window
+  bool reorderOdometry = false;
+
+  // If set, subscribe to raw gyro readings and preintegrate them into one
+  // rotation factor between each pair of states
+  std::optional<ImuConfig> imu;
+
+  // If set, states are (x, y, yaw) on the floor instead of full 3d poses.
+  // Only used by the graph engine
+  std::optional<PlanarConfig> planar;
+
+  // Trajectory history publishing
+  TrajectoryConfig trajectory;
+
+  // "graph" for the factor graph, or "ekf" for a much cheaper filter
+  std::string engine = "graph";
+  // Fixed-lag smoother backend, "isam2", "batch" or "concurrent". Only used by
+  // the graph engine
+  std::string smoother = "isam2";
+  // Only used by the isam2 smoother
+  Isam2Config isam2;
+  // "corners" for a reprojection factor per tag corner, or "frame" to solve
+  // each camera frame for the camera's pose and add that as one factor. Only
+  // used by the graph engine
+  std::string visionFactors = "corners";
+  // Re-check every tag observation in the window against each new estimate,
+  // for the reprojection diagnostics. Only used by the graph engine
+  bool reprojectionDiagnostics = true;
+
+  // Until robot code sends a pose_initial_guess, start from a PnP solve of
+  // the first camera frame that sees a tag
+  bool autoInitialize = true;
+
+  // Most odometry deltas to take off NT each cycle. Past that, "coalesce"
+  // composes the oldest together and "drop" throws them away. 0 is unbounded
+  int odomQueueDepth = 100;
+  std::string odomOverflow = "coalesce";
+
+  LoadSheddingConfig loadShedding;
+
   void print(std::string_view prefix = "");
 };
 
+/**
+ * Everything one gtsam-node process runs: one LocalizerConfig per robot (or
+ * per hypothesis), all talking to the same NT server and sharing one pool of
+ * worker threads.
+ */
+struct NodeConfig {
+  std::string ntServerURI;
+
+  // Size of the worker pool shared by all robots. 0 means one per core (or
+  // per realtime.workerCpus)
+  int workerThreads = 0;
+
+  RealtimeConfig realtime;
+
+  std::vector<LocalizerConfig> robots;
+
+  void print(std::string_view prefix = "");
+};
+
+/**
+ * Parse a single-robot config
+ */
 LocalizerConfig ParseConfig(std::string_view path);
 
+/**
+ * Parse a node config. Accepts either a "robots" list, or a single-robot
+ * config which is treated as a list of one.
+ */
+NodeConfig ParseNodeConfig(std::string_view path);
+
 void from_json(const wpi::json &json, CameraConfig &config);
+void from_json(const wpi::json &json, LocalizerConfig &config);
+void from_json(const wpi::json &json, ImuConfig &config);
+void from_json(const wpi::json &json, TrajectoryConfig &config);
+void from_json(const wpi::json &json, PlanarConfig &config);
+void from_json(const wpi::json &json, Isam2Config &config);
+void from_json(const wpi::json &json, RealtimeConfig &config);
+void from_json(const wpi::json &json, LoadSheddingConfig &config);
 
 // Print CameraConfigs using fmtlib
 template <> struct fmt::formatter<CameraConfig> : formatter<string_view> {
@@ -27,36 +27,71 @@
 #include <networktables/NetworkTableInstance.h>
 
 #include "gtsam_utils.h"
-#include "localizer.h"
+#include "localizer_engine.h"
 
 using std::vector;
 using namespace gtsam;
 
-DataPublisher::DataPublisher(std::string rootTable,
-                             std::shared_ptr<Localizer> localizer_)
+DataPublisher::DataPublisher(LocalizerConfig config,
+                             std::shared_ptr<LocalizerEngine> localizer_)
     : localizer(localizer_),
-      optimizedPosePub(
-          nt::NetworkTableInstance::GetDefault()
-              .GetStructTopic<frc::Pose3d>(rootTable + "/output/optimized_pose")
-              .Publish({
-                  .sendAll = true,
-                  .keepDuplicates = true,
-              })),
-      trajectoryHistoryPub(nt::NetworkTableInstance::GetDefault()
-                               .GetStructArrayTopic<frc::Pose3d>(
-                                   rootTable + "/output/optimized_traj")
-                               .Publish({
+      estimatePub(nt::NetworkTableInstance::GetDefault()
+                      .GetRawTopic(config.rootTableName + "/output/estimate")
+                      .Publish(wpi::Struct<LocalizerEstimate>::GetTypeString(),
+                               {
                                    .sendAll = true,
                                    .keepDuplicates = true,
                                })),
-      stdDevPub(nt::NetworkTableInstance::GetDefault()
-                    .GetDoubleArrayTopic(rootTable + "/output/pose_stddev")
-                    .Publish({
-                        .sendAll = true,
-                        .keepDuplicates = true,
-                    })) {}
-
-void DataPublisher::Update() {
+      trajectoryPub(
+          nt::NetworkTableInstance::GetDefault()
+              .GetRawTopic(config.rootTableName + "/output/traj_delta")
+              .Publish("trajdelta",
+                       {
+                           .sendAll = true,
+                           .keepDuplicates = true,
+                       })),
+      trajectoryEncoder(config.trajectory),
+      numCameras(config.cameras.size()) {
+  auto diagnostics = nt::NetworkTableInstance::GetDefault().GetTable(
+      config.rootTableName + "/output/diagnostics");
+  cameraRmsPub = diagnostics->GetDoubleArrayTopic("camera_rms").Publish();
+  cameraOutliersPub =
+      diagnostics->GetIntegerArrayTopic("camera_outliers").Publish();
+  tagIdsPub = diagnostics->GetIntegerArrayTopic("tag_ids").Publish();
+  tagRmsPub = diagnostics->GetDoubleArrayTopic("tag_rms").Publish();
+  tagOutliersPub = diagnostics->GetIntegerArrayTopic("tag_outliers").Publish();
+  tagsKeptPub = diagnostics->GetIntegerTopic("tags_kept").Publish();
+  tagsDroppedPub = diagnostics->GetIntegerTopic("tags_dropped").Publish();
+  cameraDroppedFramesPub =
+      diagnostics->GetIntegerArrayTopic("camera_dropped_frames").Publish();
+  odomDroppedPub = diagnostics->GetIntegerTopic("odom_dropped").Publish();
+  odomCoalescedPub = diagnostics->GetIntegerTopic("odom_coalesced").Publish();
+  odomStragglersPub = diagnostics->GetIntegerTopic("odom_stragglers").Publish();
+  imuDroppedPub = diagnostics->GetIntegerTopic("imu_dropped").Publish();
+  cameraStragglersPub =
+      diagnostics->GetIntegerArrayTopic("camera_stragglers").Publish();
+
+  auto latency = nt::NetworkTableInstance::GetDefault().GetTable(
+      config.rootTableName + "/output/latency");
+  odomAgeP50Pub = latency->GetDoubleTopic("odom_age_p50_ms").Publish();
+  odomAgeP99Pub = latency->GetDoubleTopic("odom_age_p99_ms").Publish();
+  odomQueueP99Pub = latency->GetDoubleTopic("odom_queue_p99_ms").Publish();
+  visionAgeP50Pub = latency->GetDoubleTopic("vision_age_p50_ms").Publish();
+  visionAgeP99Pub = latency->GetDoubleTopic("vision_age_p99_ms").Publish();
+  cameraLatencyP50Pub =
+      latency->GetDoubleArrayTopic("camera_latency_p50_ms").Publish();
+  cameraLatencyP99Pub =
+      latency->GetDoubleArrayTopic("camera_latency_p99_ms").Publish();
+  cameraQueueP99Pub =
+      latency->GetDoubleArrayTopic("camera_queue_p99_ms").Publish();
+
+  // Raw topics don't do this for us like struct topics do
+  nt::NetworkTableInstance::GetDefault().AddStructSchema<LocalizerEstimate>();
+}
+
+void DataPublisher::Update(LatencyTracker &latency,
+                           const SheddingStats &shedding,
+                           const InputQueueStats &queues) {
   if (!localizer) {
     throw std::runtime_error("Localizer was null");
   }
@@ -64,19 +99,96 @@ void DataPublisher::Update() {
   auto time = localizer->GetLastOdomTime();
 
   {
-    auto est = localizer->GetLatestWorldToBody();
-    optimizedPosePub.Set(GtsamToFrcPose3d(est), time);
+    LocalizerEstimate est{
+        GtsamToFrcPose3d(localizer->GetLatestWorldToBody()),
+        {},
+        static_cast<int64_t>(time),
+        localizer->GetCurrStateIdx(),
+        static_cast<int32_t>(localizer->GetLastVisionFactorCount()),
+        localizer->GetLastOptimizeMs(),
+    };
+
+    const Matrix cov = localizer->GetLatestMarginals();
+    size_t i = 0;
+    for (int row = 0; row < 6; row++) {
+      for (int col = row; col < 6; col++) {
+        est.covariance[i++] = cov(row, col);
+      }
+    }
+
+    wpi::Struct<LocalizerEstimate>::Pack(estimateBuffer, est);
+    estimatePub.Set(estimateBuffer, time);
+    latency.Published(static_cast<uint64_t>(nt::Now()));
   }
   {
-    auto mat = localizer->GetPoseComponentStdDevs();
-    std::vector<double> vec(mat.data(), mat.data() + mat.rows() * mat.cols());
-    stdDevPub.Set(vec, time);
+    publishCount++;
+
+    if (publishCount % 3 == 2)
+      trajectoryPub.Set(trajectoryEncoder.Encode(localizer->GetPoseHistory()));
   }
-  {
-    static int i;
-    i++;
+  PublishDiagnostics();
+  tagsKeptPub.Set(static_cast<int64_t>(shedding.kept));
+  tagsDroppedPub.Set(static_cast<int64_t>(shedding.dropped));
+  cameraDroppedFramesPub.Set(queues.cameraDroppedFrames);
+  odomDroppedPub.Set(queues.odomDropped);
+  odomCoalescedPub.Set(queues.odomCoalesced);
+  odomStragglersPub.Set(queues.odomStragglers);
+  cameraStragglersPub.Set(queues.cameraStragglers);
+  imuDroppedPub.Set(static_cast<int64_t>(localizer->GetDroppedImuCount()));
+  PublishLatency(latency);
+}
+
+void DataPublisher::PublishDiagnostics() {
+  const ReprojectionSummary &summary = localizer->GetReprojectionSummary();
+
+  // Cameras that saw nothing in the window get 0 rms, 0 outliers
+  rmsScratch.assign(numCameras, 0);
+  outlierScratch.assign(numCameras, 0);
+  for (const auto &[camera, stats] : summary.perCamera) {
+    if (camera < numCameras) {
+      rmsScratch[camera] = stats.rms;
+      outlierScratch[camera] = stats.outliers;
+    }
+  }
+  cameraRmsPub.Set(rmsScratch);
+  cameraOutliersPub.Set(outlierScratch);
+
+  rmsScratch.clear();
+  outlierScratch.clear();
+  idScratch.clear();
+  for (const auto &[tag, stats] : summary.perTag) {
+    idScratch.push_back(tag);
+    rmsScratch.push_back(stats.rms);
+    outlierScratch.push_back(stats.outliers);
+  }
+  tagIdsPub.Set(idScratch);
+  tagRmsPub.Set(rmsScratch);
+  tagOutliersPub.Set(outlierScratch);
+}
+
+void DataPublisher::PublishLatency(const LatencyTracker &latency) {
+  const LatencyPercentiles odomAge = latency.OdomAge();
+  odomAgeP50Pub.Set(odomAge.p50Ms);
+  odomAgeP99Pub.Set(odomAge.p99Ms);
+  odomQueueP99Pub.Set(latency.OdomQueueDelay().p99Ms);
+
+  const LatencyPercentiles visionAge = latency.VisionAge();
+  visionAgeP50Pub.Set(visionAge.p50Ms);
+  visionAgeP99Pub.Set(visionAge.p99Ms);
+
+  p50Scratch.clear();
+  p99Scratch.clear();
+  for (size_t i = 0; i < latency.NumCameras(); i++) {
+    const LatencyPercentiles camera = latency.CameraLatency(i);
+    p50Scratch.push_back(camera.p50Ms);
+    p99Scratch.push_back(camera.p99Ms);
+  }
+  cameraLatencyP50Pub.Set(p50Scratch);
+  cameraLatencyP99Pub.Set(p99Scratch);
 
-    if (i % 3 == 2)
-      trajectoryHistoryPub.Set(localizer->GetPoseHistory());
+  p99Scratch.clear();
+  for (size_t i = 0; i < latency.NumCameras(); i++) {
+    p99Scratch.push_back(latency.CameraQueueDelay(i).p99Ms);
   }
+  cameraQueueP99Pub.Set(p99Scratch);
 }
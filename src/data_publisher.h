@@ -26,38 +26,98 @@
 
 #include <gtsam/linear/NoiseModel.h>
 
+#include <array>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <frc/geometry/Pose3d.h>
 #include <networktables/DoubleArrayTopic.h>
-#include <networktables/StructArrayTopic.h>
-#include <networktables/StructTopic.h>
+#include <networktables/DoubleTopic.h>
+#include <networktables/IntegerArrayTopic.h>
+#include <networktables/IntegerTopic.h>
+#include <networktables/RawTopic.h>
 
+#include "LocalizerEstimateStruct.h"
 #include "TagDetectionStruct.h"
 #include "config.h"
+#include "input_queue.h"
+#include "latency_tracker.h"
+#include "load_shedder.h"
+#include "trajectory_delta.h"
 
-class Localizer;
+class LocalizerEngine;
 
 /**
  * Set of topics to publish things to NT
  */
 class DataPublisher {
 public:
-  DataPublisher(std::string rootTable, std::shared_ptr<Localizer> localizer);
+  DataPublisher(LocalizerConfig config,
+                std::shared_ptr<LocalizerEngine> localizer);
 
   /**
    * Publish new data to NT
+   *
+   * @param latency told when the estimate went out, then published too
+   * @param shedding what load shedding did with this estimate's vision
+   * @param queues what overflowed the listeners' input queues so far
    */
-  void Update();
+  void Update(LatencyTracker &latency, const SheddingStats &shedding,
+              const InputQueueStats &queues);
 
 private:
-  std::shared_ptr<Localizer> localizer;
-
-  // field-robot optimized pose
-  nt::StructPublisher<frc::Pose3d> optimizedPosePub;
-  // Trajectory over an arbitrary past time
-  nt::StructArrayPublisher<frc::Pose3d> trajectoryHistoryPub;
-  // standard deviations on rx ry rz tx ty tz
-  nt::DoubleArrayPublisher stdDevPub;
+  std::shared_ptr<LocalizerEngine> localizer;
+
+  // Latest pose, covariance and metadata, as one struct:LocalizerEstimate.
+  // Published raw so we can pack into our own buffer instead of allocating
+  // one every cycle
+  nt::RawPublisher estimatePub;
+  std::array<uint8_t, wpi::Struct<LocalizerEstimate>::GetSize()>
+      estimateBuffer{};
+  // Trajectory over an arbitrary past time, delta encoded
+  nt::RawPublisher trajectoryPub;
+  TrajectoryDeltaEncoder trajectoryEncoder;
+
+  // Reprojection residuals over the window. Per camera arrays are in config
+  // order, per tag arrays line up with tagIdsPub
+  size_t numCameras;
+  nt::DoubleArrayPublisher cameraRmsPub;
+  nt::IntegerArrayPublisher cameraOutliersPub;
+  nt::IntegerArrayPublisher tagIdsPub;
+  nt::DoubleArrayPublisher tagRmsPub;
+  nt::IntegerArrayPublisher tagOutliersPub;
+  // Tag observations load shedding let in and threw away, last cycle
+  nt::IntegerPublisher tagsKeptPub;
+  nt::IntegerPublisher tagsDroppedPub;
+  // Input queue overflow, cumulative
+  nt::IntegerArrayPublisher cameraDroppedFramesPub;
+  nt::IntegerPublisher odomDroppedPub;
+  nt::IntegerPublisher odomCoalescedPub;
+  nt::IntegerPublisher odomStragglersPub;
+  nt::IntegerPublisher imuDroppedPub;
+  nt::IntegerArrayPublisher cameraStragglersPub;
+  // Reused every publish
+  std::vector<double> rmsScratch;
+  std::vector<int64_t> outlierScratch;
+  std::vector<int64_t> idScratch;
+
+  void PublishDiagnostics();
+
+  // Sensor -> output latency, in ms. Per camera arrays are in config order
+  nt::DoublePublisher odomAgeP50Pub;
+  nt::DoublePublisher odomAgeP99Pub;
+  nt::DoublePublisher odomQueueP99Pub;
+  nt::DoublePublisher visionAgeP50Pub;
+  nt::DoublePublisher visionAgeP99Pub;
+  nt::DoubleArrayPublisher cameraLatencyP50Pub;
+  nt::DoubleArrayPublisher cameraLatencyP99Pub;
+  nt::DoubleArrayPublisher cameraQueueP99Pub;
+  std::vector<double> p50Scratch;
+  std::vector<double> p99Scratch;
+
+  void PublishLatency(const LatencyTracker &latency);
+
+  // How many times we've published, so we only send history every so often
+  int publishCount = 0;
 };
@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "distortion.h"
+
+#include <cmath>
+
+using namespace gtsam;
+
+Point2 DistortionCoefficients::Distort(const Point2 &normalized) const {
+  const double x = normalized.x();
+  const double y = normalized.y();
+
+  const double r2 = x * x + y * y;
+  const double r4 = r2 * r2;
+  const double r6 = r4 * r2;
+  const double radial =
+      (1 + k1 * r2 + k2 * r4 + k3 * r6) / (1 + k4 * r2 + k5 * r4 + k6 * r6);
+
+  return Point2{x * radial + 2 * p1 * x * y + p2 * (r2 + 2 * x * x),
+                y * radial + p1 * (r2 + 2 * y * y) + 2 * p2 * x * y};
+}
+
+Point2 UndistortIterative(const Cal3_S2 &K, const DistortionCoefficients &d,
+                          const Point2 &pixel, int iterations) {
+  // Distorted, normalized
+  const Point2 distorted = K.calibrate(pixel);
+  const double x0 = distorted.x();
+  const double y0 = distorted.y();
+
+  double x = x0;
+  double y = y0;
+  for (int i = 0; i < iterations; i++) {
+    const double r2 = x * x + y * y;
+    const double r4 = r2 * r2;
+    const double r6 = r4 * r2;
+    const double invRadial = (1 + d.k4 * r2 + d.k5 * r4 + d.k6 * r6) /
+                             (1 + d.k1 * r2 + d.k2 * r4 + d.k3 * r6);
+    const double deltaX = 2 * d.p1 * x * y + d.p2 * (r2 + 2 * x * x);
+    const double deltaY = d.p1 * (r2 + 2 * y * y) + 2 * d.p2 * x * y;
+
+    x = (x0 - deltaX) * invRadial;
+    y = (y0 - deltaY) * invRadial;
+  }
+
+  return Point2{x, y};
+}
+
+UndistortionLut::UndistortionLut(const Cal3_S2 &K,
+                                 const DistortionCoefficients &distortion,
+                                 int width, int height, double step)
+    : invStep(1.0 / step),
+      // one extra column/row past the edge, so every pixel in the image has a
+      // cell to interpolate in
+      cols(static_cast<int>(std::ceil(width / step)) + 2),
+      rows(static_cast<int>(std::ceil(height / step)) + 2) {
+  table.reserve(static_cast<size_t>(cols) * rows);
+
+  for (int iy = 0; iy < rows; iy++) {
+    for (int ix = 0; ix < cols; ix++) {
+      table.push_back(
+          UndistortIterative(K, distortion, Point2{ix * step, iy * step}));
+    }
+  }
+}
@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Cal3_S2.h>
+#include <gtsam/geometry/Point2.h>
+
+#include <optional>
+#include <vector>
+
+/**
+ * OpenCV-style 8 parameter (rational) Brown-Conrady lens distortion, in
+ * OpenCV's order [k1 k2 p1 p2 k3 k4 k5 k6]. The plain 5 parameter model is
+ * this with k4-k6 zero.
+ */
+struct DistortionCoefficients {
+  double k1 = 0;
+  double k2 = 0;
+  double p1 = 0;
+  double p2 = 0;
+  double k3 = 0;
+  double k4 = 0;
+  double k5 = 0;
+  double k6 = 0;
+
+  bool operator==(const DistortionCoefficients &) const = default;
+
+  bool IsZero() const { return *this == DistortionCoefficients{}; }
+
+  /**
+   * Apply distortion to an (undistorted) normalized image point
+   */
+  gtsam::Point2 Distort(const gtsam::Point2 &normalized) const;
+};
+
+/**
+ * Undistort one pixel into normalized image coordinates the slow way, by
+ * fixed-point iteration (same as cv::undistortPoints)
+ */
+gtsam::Point2 UndistortIterative(const gtsam::Cal3_S2 &K,
+                                 const DistortionCoefficients &distortion,
+                                 const gtsam::Point2 &pixel,
+                                 int iterations = 20);
+
+/**
+ * Dense table of pixel -> undistorted normalized image coordinates, built
+ * once per calibration. Lookups bilinearly interpolate between grid points,
+ * so each corner costs a handful of multiplies instead of an iterative solve.
+ */
+class UndistortionLut {
+public:
+  /**
+   * @param width,height image size in pixels
+   * @param step grid spacing in pixels
+   */
+  UndistortionLut(const gtsam::Cal3_S2 &K,
+                  const DistortionCoefficients &distortion, int width,
+                  int height, double step);
+
+  /**
+   * Undistorted normalized coordinates for a pixel, or nullopt if it falls
+   * outside the table
+   */
+  inline std::optional<gtsam::Point2> Lookup(const gtsam::Point2 &pixel) const {
+    const double gx = pixel.x() * invStep;
+    const double gy = pixel.y() * invStep;
+    // written this way so NaNs fail too
+    if (!(gx >= 0 && gy >= 0 && gx < cols - 1 && gy < rows - 1)) {
+      return std::nullopt;
+    }
+
+    const int ix = static_cast<int>(gx);
+    const int iy = static_cast<int>(gy);
+    const double fx = gx - ix;
+    const double fy = gy - iy;
+
+    const gtsam::Point2 *top = &table[iy * cols + ix];
+    const gtsam::Point2 *bottom = top + cols;
+    return gtsam::Point2{(1 - fy) * ((1 - fx) * top[0] + fx * top[1]) +
+                         fy * ((1 - fx) * bottom[0] + fx * bottom[1])};
+  }
+
+  size_t SizeBytes() const { return table.size() * sizeof(gtsam::Point2); }
+
+private:
+  double invStep;
+  int cols;
+  int rows;
+  // row-major, entry (ix, iy) is the pixel (ix * step, iy * step)
+  std::vector<gtsam::Point2> table;
+};
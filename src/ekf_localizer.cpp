@@ -0,0 +1,246 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ekf_localizer.h"
+
+#include <gtsam/geometry/CalibratedCamera.h>
+#include <gtsam/inference/Symbol.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include <fmt/format.h>
+
+using namespace gtsam;
+using symbol_shorthand::X;
+
+// Reject corners this far out (squared mahalanobis, 2 dof ~99.9%)
+constexpr double CORNER_GATE_CHI2 = 13.8;
+
+/**
+ * Push pose/cov through an odometry delta. Our error is in the pose's tangent
+ * space (same as GTSAM's Jacobians), so the old error gets carried over by
+ * the compose Jacobian, and the odometry's own noise adds on top
+ */
+static void Predict(const Pose3 &pose, const Matrix6 &cov, const Pose3 &delta,
+                    const Matrix6 &deltaCov, Pose3 &outPose, Matrix6 &outCov) {
+  Matrix6 F;
+  outPose = pose.compose(delta, F);
+  outCov = F * cov * F.transpose() + deltaCov;
+}
+
+void EkfLocalizer::Reset(Pose3 wTr, SharedNoiseModel noise, uint64_t timeUs) {
+  const Matrix6 cov = CovarianceOf(noise);
+
+  states.clear();
+  settled.clear();
+  firstDirty = SIZE_MAX;
+
+  states.push_back(State{
+      .timeUs = timeUs,
+      .delta = Pose3{},
+      .deltaCov = Matrix6::Zero(),
+      .vision = {},
+      .priorPose = wTr,
+      .priorCov = cov,
+      .pose = wTr,
+      .cov = cov,
+  });
+}
+
+void EkfLocalizer::SetTagLayout(const frc::AprilTagFieldLayout &layout) {
+  tagModel.SetLayout(layout);
+}
+
+void EkfLocalizer::EnableImu(const ImuConfig &) {
+  fmt::println("EKF engine doesn't use the IMU yet, ignoring it");
+}
+
+void EkfLocalizer::AddImu(const ImuObservation &) {}
+
+void EkfLocalizer::AddOdometry(const OdometryObservation &odom) {
+  if (states.empty()) {
+    // No prior yet
+    return;
+  }
+
+  State next{
+      .timeUs = odom.timeUs,
+      .delta = odom.poseDelta,
+      .deltaCov = CovarianceOf(*odom.odometryNoise),
+  };
+  Predict(states.back().pose, states.back().cov, next.delta, next.deltaCov,
+          next.priorPose, next.priorCov);
+  next.pose = next.priorPose;
+  next.cov = next.priorCov;
+
+  states.push_back(std::move(next));
+}
+
+void EkfLocalizer::AddTagObservation(const CameraVisionObservation &obs) {
+  if (states.empty() || obs.timeUs < states.front().timeUs) {
+    // Too late, that part of history is settled
+    return;
+  }
+
+  // Hang it off whichever state is closest in time
+  auto it = std::lower_bound(
+      states.begin(), states.end(), obs.timeUs,
+      [](const State &s, uint64_t time) { return s.timeUs < time; });
+  if (it == states.end()) {
+    it = std::prev(it);
+  } else if (it != states.begin() &&
+             obs.timeUs - std::prev(it)->timeUs < it->timeUs - obs.timeUs) {
+    it = std::prev(it);
+  }
+
+  it->vision.push_back(obs);
+  firstDirty = std::min(firstDirty, static_cast<size_t>(it - states.begin()));
+}
+
+size_t EkfLocalizer::UpdateWithTag(const CameraVisionObservation &obs,
+                                   Pose3 &pose, Matrix6 &cov) const {
+  const auto worldPcorners = tagModel.WorldToCorners(obs.tagID);
+  if (!worldPcorners) {
+    return 0;
+  }
+
+  Matrix2 R = Matrix2::Zero();
+  R.diagonal() = (*obs.cameraNoise)->sigmas().cwiseAbs2();
+
+  size_t used = 0;
+  const size_t numCorners = std::min(worldPcorners->size(), obs.corners.size());
+  for (size_t i = 0; i < numCorners; i++) {
+    // Same measurement model as the graph's factors, just linearized once
+    Matrix6 Hcompose;
+    Matrix36 Htransform;
+    Matrix23 Hproject;
+    const Pose3 worldTcamera = pose.compose(obs.robotTcamera, Hcompose);
+    const Point3 camPcorner =
+        worldTcamera.transformTo((*worldPcorners)[i], Htransform);
+    if (camPcorner.z() <= 1e-3) {
+      // behind the camera
+      continue;
+    }
+    const Point2 predicted = PinholeBase::Project(camPcorner, Hproject);
+    const Matrix26 H = Hproject * Htransform * Hcompose;
+
+    const Vector2 innovation = obs.corners[i] - predicted;
+    const Matrix2 S = H * cov * H.transpose() + R;
+    const Matrix2 Sinv = S.inverse();
+    if (innovation.dot(Sinv * innovation) > CORNER_GATE_CHI2) {
+      continue;
+    }
+
+    const Matrix62 K = cov * H.transpose() * Sinv;
+    pose = pose.retract(K * innovation);
+    // Joseph form, stays symmetric positive definite
+    const Matrix6 IKH = Matrix6::Identity() - K * H;
+    cov = IKH * cov * IKH.transpose() + K * R * K.transpose();
+    used++;
+  }
+
+  return used;
+}
+
+void EkfLocalizer::Optimize() {
+  const auto start = std::chrono::steady_clock::now();
+  lastVisionUpdates = 0;
+
+  // Re-run from the oldest state with new vision. Usually only a handful of
+  // states, since vision is only ever tens of ms late
+  for (size_t i = firstDirty; i < states.size(); i++) {
+    State &s = states[i];
+    if (i > firstDirty) {
+      const State &prev = states[i - 1];
+      Predict(prev.pose, prev.cov, s.delta, s.deltaCov, s.priorPose,
+              s.priorCov);
+    }
+
+    s.pose = s.priorPose;
+    s.cov = s.priorCov;
+    for (const auto &obs : s.vision) {
+      lastVisionUpdates += UpdateWithTag(obs, s.pose, s.cov);
+    }
+  }
+  firstDirty = SIZE_MAX;
+
+  // Anything older than our buffer is final
+  while (states.size() > 1 &&
+         states.front().timeUs + kBufferUs < states.back().timeUs) {
+    settled.push_back({states.front().timeUs, states.front().pose});
+    states.pop_front();
+  }
+  while (!settled.empty() &&
+         settled.front().time + kHistoryUs < states.back().timeUs) {
+    settled.pop_front();
+  }
+
+  lastOptimizeMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+}
+
+void EkfLocalizer::Print(const std::string_view prefix) {
+  fmt::println("{}", prefix);
+  if (states.empty()) {
+    fmt::println("EKF: no prior yet");
+    return;
+  }
+  fmt::println("EKF: {} buffered states, latest at {}", states.size(),
+               states.back().timeUs);
+  states.back().pose.print("Latest pose: ");
+}
+
+Key EkfLocalizer::GetCurrStateIdx() const {
+  return states.empty() ? 0 : X(states.back().timeUs);
+}
+
+uint64_t EkfLocalizer::GetLastOdomTime() const {
+  return states.empty() ? 0 : states.back().timeUs;
+}
+
+const Pose3 EkfLocalizer::GetLatestWorldToBody() const {
+  return states.empty() ? Pose3{} : states.back().pose;
+}
+
+Matrix EkfLocalizer::GetLatestMarginals() const {
+  return states.empty() ? Matrix6::Identity().eval() : states.back().cov;
+}
+
+const std::vector<Timestamped<frc::Pose3d>>
+EkfLocalizer::GetPoseHistory() const {
+  std::vector<Timestamped<frc::Pose3d>> ret;
+  ret.reserve(settled.size() + states.size());
+
+  for (const auto &pose : settled) {
+    ret.emplace_back(pose.time, GtsamToFrcPose3d(pose.value));
+  }
+  for (const auto &state : states) {
+    ret.emplace_back(state.timeUs, GtsamToFrcPose3d(state.pose));
+  }
+
+  return ret;
+}
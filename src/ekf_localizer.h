@@ -0,0 +1,126 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Pose3.h>
+
+#include <deque>
+#include <vector>
+
+#include "TagModel.h"
+#include "localizer_engine.h"
+
+/**
+ * Error-state EKF on SE(3), for coprocessors that can't keep up with the
+ * factor graph. Odometry predicts, and every tag corner is its own small
+ * reprojection update. Costs about the same every cycle no matter how long
+ * we've been running.
+ *
+ * Vision shows up late, so we keep the last bufferLength of states along with
+ * the odometry and measurements that built them. A late observation is
+ * attached to the state closest to its capture time, and the filter is re-run
+ * from there forward.
+ */
+class EkfLocalizer : public LocalizerEngine {
+public:
+  // How far back late vision can still land, uS
+  static constexpr uint64_t kBufferUs = 500 * 1000;
+  // How much settled history we hang on to for GetPoseHistory, uS
+  static constexpr uint64_t kHistoryUs = 5 * 1000 * 1000;
+
+  EkfLocalizer() = default;
+
+  void Reset(gtsam::Pose3 wTr, gtsam::SharedNoiseModel noise,
+             uint64_t timeUs) override;
+  void SetTagLayout(const frc::AprilTagFieldLayout &layout) override;
+
+  // No gyro support yet, these just warn/drop
+  void EnableImu(const ImuConfig &config) override;
+  void AddImu(const ImuObservation &imu) override;
+
+  void AddOdometry(const OdometryObservation &odom) override;
+  void AddTagObservation(const CameraVisionObservation &obs) override;
+
+  /**
+   * Re-run the filter from the oldest state that got new measurements
+   */
+  void Optimize() override;
+
+  void Print(const std::string_view prefix = "") override;
+
+  gtsam::Key GetCurrStateIdx() const override;
+  uint64_t GetLastOdomTime() const override;
+  const gtsam::Pose3 GetLatestWorldToBody() const override;
+  gtsam::Matrix GetLatestMarginals() const override;
+  const std::vector<Timestamped<frc::Pose3d>> GetPoseHistory() const override;
+
+  inline size_t GetLastVisionFactorCount() const override {
+    return lastVisionUpdates;
+  }
+  inline double GetLastOptimizeMs() const override { return lastOptimizeMs; }
+  // We ignore the IMU altogether
+  inline size_t GetDroppedImuCount() const override { return 0; }
+  // We don't keep old vision around long enough for this to mean much
+  inline const ReprojectionSummary &GetReprojectionSummary() const override {
+    return reprojection;
+  }
+
+private:
+  struct State {
+    uint64_t timeUs;
+    // Odometry from the previous state to this one, and its covariance
+    gtsam::Pose3 delta;
+    gtsam::Matrix6 deltaCov;
+    // Vision captured closest to this state
+    std::vector<CameraVisionObservation> vision;
+    // Estimate before and after this state's vision
+    gtsam::Pose3 priorPose;
+    gtsam::Matrix6 priorCov;
+    gtsam::Pose3 pose;
+    gtsam::Matrix6 cov;
+  };
+
+  /**
+   * Apply one tag's corners to pose/cov
+   *
+   * @return how many corners made it through gating
+   */
+  size_t UpdateWithTag(const CameraVisionObservation &obs, gtsam::Pose3 &pose,
+                       gtsam::Matrix6 &cov) const;
+
+  // Recent states, oldest first
+  std::deque<State> states;
+  // Anything older, frozen for GetPoseHistory
+  std::deque<Timestamped<gtsam::Pose3>> settled;
+  // Oldest index in states with measurements we haven't filtered yet
+  size_t firstDirty = SIZE_MAX;
+
+  TagModel tagModel{TagModel::DefaultLayout()};
+
+  size_t lastVisionUpdates = 0;
+  double lastOptimizeMs = 0;
+  // Always empty
+  ReprojectionSummary reprojection;
+};
@@ -22,110 +22,19 @@
  * SOFTWARE.
  */
 
-#include <iostream>
 #include <memory>
 #include <thread>
+#include <vector>
 
-#include <frc/geometry/Rotation3d.h>
-#include <frc/geometry/struct/Pose3dStruct.h>
-#include <frc/geometry/struct/Twist3dStruct.h>
-#include <networktables/DoubleArrayTopic.h>
-#include <networktables/DoubleTopic.h>
 #include <networktables/NetworkTableInstance.h>
-#include <networktables/StructArrayTopic.h>
-#include <networktables/StructTopic.h>
 
-#include "TagDetectionStruct.h"
-#include "TagModel.h"
-#include "camera_listener.h"
 #include "config.h"
-#include "config_listener.h"
-#include "data_publisher.h"
-#include "gtsam_utils.h"
-#include "localizer.h"
-#include "odom_listener.h"
+#include "localizer_runner.h"
+#include "realtime.h"
+#include "worker_pool.h"
 
-using namespace gtsam;
-using std::vector;
 using namespace std::chrono_literals;
 
-class LocalizerRunner {
-private:
-  std::shared_ptr<Localizer> localizer;
-  OdomListener odomListener;
-  DataPublisher dataPublisher;
-  ConfigListener configListener;
-  std::vector<CameraListener> cameraListeners;
-
-  bool gotInitialGuess = false;
-
-public:
-  explicit LocalizerRunner(LocalizerConfig config)
-      : localizer(std::make_shared<Localizer>()), odomListener{config},
-        dataPublisher(config.rootTableName, localizer), configListener(config) {
-    cameraListeners.reserve(config.cameras.size());
-    for (const CameraConfig &camCfg : config.cameras) {
-      cameraListeners.emplace_back(config.rootTableName, camCfg);
-    }
-  }
-
-  void Update() {
-    bool readyToOptimize = true;
-
-    if (const auto prior = configListener.NewPosePrior()) {
-      localizer->Reset(prior->value.pose, prior->value.noise, prior->time);
-      gotInitialGuess = true;
-    }
-
-    if (const auto layout = configListener.NewTagLayout()) {
-      TagModel::SetLayout(*layout);
-
-      // Reset initial guess tracking since we got a new layout and our factors
-      // are technically now wrong
-      gotInitialGuess = false;
-    }
-
-    readyToOptimize &= gotInitialGuess;
-
-    for (const auto &it : odomListener.Update()) {
-      localizer->AddOdometry(it);
-    }
-
-    // localizer->Print("=========================\nAfter adding odometry
-    // factors");
-
-    for (auto &cam : cameraListeners) {
-      bool ready = cam.ReadyToOptimize();
-      readyToOptimize &= ready;
-
-      if (ready) {
-        for (const auto &it : cam.Update()) {
-          localizer->AddTagObservation(it);
-        }
-      }
-    }
-
-    if (!readyToOptimize) {
-      fmt::println("Not yet ready (see above) -- busywaiting");
-      std::this_thread::sleep_for(1000ms);
-      return;
-    }
-
-    // localizer->Print("=========================\nAfter adding vision
-    // factors");
-
-    try {
-      localizer->Optimize();
-      dataPublisher.Update();
-      nt::NetworkTableInstance::GetDefault().Flush();
-    } catch (const std::exception &e) {
-      fmt::println("Exception optimizing: {}", e.what());
-      localizer->Print();
-      throw e;
-    }
-  }
-};
-
 int main(int argc, char **argv) {
   std::string configPath;
   if (argc == 1) {
@@ -138,7 +47,7 @@ int main(int argc, char **argv) {
   }
 
   fmt::println("Loading config from: {}", configPath);
-  LocalizerConfig config = ParseConfig(configPath);
+  NodeConfig config = ParseNodeConfig(configPath);
   config.print("Loaded config:");
 
   nt::NetworkTableInstance inst = nt::NetworkTableInstance::GetDefault();
@@ -147,10 +56,36 @@ int main(int argc, char **argv) {
   inst.SetServer(config.ntServerURI.c_str());
   inst.StartClient4("gtsam-meme");
 
-  LocalizerRunner runner(config);
+  const RealtimeConfig &realtime = config.realtime;
+  ConfigureCurrentThread(realtime.mainCpus, realtime);
+
+  // One pool for every robot. Runners are independent, so they just get
+  // farmed out across it each loop, and each runner spreads its cameras
+  // across it too
+  int workerThreads = config.workerThreads;
+  if (workerThreads <= 0 && !realtime.workerCpus.empty()) {
+    // main loop thread counts as a worker
+    workerThreads = static_cast<int>(realtime.workerCpus.size()) + 1;
+  }
+  WorkerPool pool(workerThreads, [&realtime] {
+    ConfigureCurrentThread(realtime.workerCpus, realtime);
+  });
+
+  std::vector<std::unique_ptr<LocalizerRunner>> runners;
+  runners.reserve(config.robots.size());
+  for (const LocalizerConfig &robot : config.robots) {
+    runners.push_back(std::make_unique<LocalizerRunner>(robot, pool));
+  }
+
+  // Everything's allocated up front by now
+  if (realtime.lockMemory) {
+    LockMemory();
+  }
 
   while (true) {
-    runner.Update();
+    pool.ParallelFor(runners.size(),
+                     [&runners](size_t i) { runners[i]->Update(); });
+    inst.Flush();
 
     std::this_thread::sleep_for(10ms);
   }
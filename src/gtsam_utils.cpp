@@ -40,9 +40,18 @@ Pose3 Transform3dToGtsamPose3(frc::Transform3d pose) {
                       pose.Z().to<double>())};
 }
 
+Matrix6 CovarianceOf(const SharedNoiseModel &noise) {
+  if (const auto gaussian =
+          std::dynamic_pointer_cast<noiseModel::Gaussian>(noise)) {
+    return gaussian->covariance();
+  }
+  Matrix6 cov = Matrix6::Zero();
+  cov.diagonal() = noise->sigmas().cwiseAbs2();
+  return cov;
+}
+
 gtsam::Point2_ PredictLandmarkImageLocation(gtsam::Pose3_ worldTbody_fac,
                                             gtsam::Pose3 bodyPcamera,
-                                            gtsam::Cal3_S2_ cameraCal,
                                             gtsam::Point3 worldPcorner) {
   using namespace gtsam;
 
@@ -52,10 +61,9 @@ gtsam::Point2_ PredictLandmarkImageLocation(gtsam::Pose3_ worldTbody_fac,
       Pose3_(worldTbody_fac, &Pose3::transformPoseFrom, Pose3_(bodyPcamera));
   // Camera->tag corner vector
   const Point3_ camPcorner = transformTo(worldTcamera_fac, worldPcorner);
-  // project from vector down to pinhole location, then uncalibrate to pixel
-  // locations
-  const Point2_ prediction =
-      uncalibrate<Cal3_S2>(cameraCal, project(camPcorner));
+  // project from vector down to pinhole location. Measurements are already
+  // normalized, so no need to uncalibrate back to pixels
+  const Point2_ prediction = project(camPcorner);
 
   return prediction;
 }
@@ -37,24 +37,41 @@ struct CameraVisionObservation {
   uint64_t timeUs;
   // ID of observed tag, to later index into layout map
   int tagID;
-  // Detected tag corners, in "canonical" order
+  // Detected tag corners, in "canonical" order. These are in normalized image
+  // coordinates (ie, already run through K^-1), so factors never need to
+  // know about the camera calibration
   std::vector<gtsam::Point2> corners;
-  // Calibration of camera observing this
-  // TODO: see if I can switch this to a shared-ptr, not sure if that's any
-  // faster
-  // TODO: maybe just unprojecting points to pinhole -1,1 would mean we could
-  // get rid of this entirely?
-  gtsam::Cal3_S2_ cameraCal;
   // Offset from robot kinematic center -> camera optical center
   gtsam::Pose3 robotTcamera;
-  // Pixel noise in camera
-  gtsam::SharedNoiseModel cameraNoise;
+  // Corner noise, in normalized image coordinates. Interned in a
+  // ModelRegistry, so every observation from this camera shares one model
+  const gtsam::SharedNoiseModel *cameraNoise;
+  // Which of the robot's cameras saw this, in config order. Only used for
+  // diagnostics
+  uint32_t cameraIndex = 0;
+  // When a listener took it off its NT queue, same time base as timeUs. Not
+  // when it reached us: it may have sat in the queue until the cycle read it.
+  // Only used for latency tracking
+  uint64_t readUs = 0;
 };
 
 struct OdometryObservation {
   uint64_t timeUs;
   gtsam::Pose3 poseDelta;
-  gtsam::SharedNoiseModel odometryNoise;
+  // Interned in a ModelRegistry, shared by every odometry factor
+  const gtsam::SharedNoiseModel *odometryNoise;
+  // When a listener took it off its NT queue, same time base as timeUs. Not
+  // when it reached us: it may have sat in the queue until the cycle read it.
+  // Only used for latency tracking
+  uint64_t readUs = 0;
+};
+
+struct ImuObservation {
+  uint64_t timeUs;
+  // IMU-frame angular rate, rad/s
+  gtsam::Vector3 gyro;
+  // IMU-frame specific force, m/s^2
+  gtsam::Vector3 accel;
 };
 
 template <typename T> struct Timestamped {
@@ -71,7 +88,15 @@ gtsam::Pose3 Pose3dToGtsamPose3(frc::Pose3d pose);
 gtsam::Pose3 Transform3dToGtsamPose3(frc::Transform3d pose);
 frc::Pose3d GtsamToFrcPose3d(gtsam::Pose3 pose);
 
+/**
+ * Full 6x6 covariance of a pose noise model, whether it's diagonal or not
+ */
+gtsam::Matrix6 CovarianceOf(const gtsam::SharedNoiseModel &noise);
+
+/**
+ * Where we expect a world-frame point to land in a camera, in normalized
+ * image coordinates
+ */
 gtsam::Point2_ PredictLandmarkImageLocation(gtsam::Pose3_ worldTbody_fac,
                                             gtsam::Pose3 bodyPcamera,
-                                            gtsam::Cal3_S2_ cameraCal,
                                             gtsam::Point3 worldPcorner);
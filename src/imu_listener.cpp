@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "imu_listener.h"
+
+#include <networktables/NetworkTableInstance.h>
+
+using namespace gtsam;
+
+ImuListener::ImuListener(LocalizerConfig config)
+    : imuSub(nt::NetworkTableInstance::GetDefault()
+                 .GetStructTopic<ImuSample>(config.rootTableName +
+                                            "/input/imu")
+                 .Subscribe({},
+                            {
+                                // 1khz, so this is a second of backlog
+                                .pollStorage = 1000,
+                                .sendAll = true,
+                                .keepDuplicates = true,
+                            })) {}
+
+std::vector<ImuObservation> ImuListener::Update() {
+  const auto samples = imuSub.ReadQueue();
+
+  std::vector<ImuObservation> ret;
+  ret.reserve(samples.size());
+
+  for (const auto &s : samples) {
+    const ImuSample &imu = s.value;
+    ret.emplace_back(static_cast<uint64_t>(s.time),
+                     Vector3{imu.gyroX, imu.gyroY, imu.gyroZ},
+                     Vector3{imu.accelX, imu.accelY, imu.accelZ});
+  }
+
+  return ret;
+}
@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "input_queue.h"
+
+#include <algorithm>
+
+using namespace gtsam;
+
+unsigned int PollStorageFor(int depth) {
+  if (depth <= 0) {
+    return kUnboundedPollStorage;
+  }
+  return static_cast<unsigned int>(std::max(100, 2 * depth));
+}
+
+OdometryObservation ComposeOdometry(std::span<const OdometryObservation> run,
+                                    ModelRegistry &registry) {
+  OdometryObservation ret = run.back();
+
+  // Each piece's noise is in its own starting frame, so carry what we have
+  // so far through it first (same as the EKF's Predict)
+  Pose3 delta = run.front().poseDelta;
+  Matrix6 cov = CovarianceOf(*run.front().odometryNoise);
+  for (size_t i = 1; i < run.size(); i++) {
+    Matrix6 F;
+    delta = delta.compose(run[i].poseDelta, F);
+    cov = F * cov * F.transpose() + CovarianceOf(*run[i].odometryNoise);
+  }
+
+  ret.poseDelta = delta;
+  ret.odometryNoise = &registry.InternCovariance(cov);
+  return ret;
+}
+
+size_t CoalesceOdometry(std::vector<OdometryObservation> &batch, size_t depth,
+                        ModelRegistry &registry) {
+  if (depth == 0 || batch.size() <= depth) {
+    return 0;
+  }
+
+  // The first merged ones fold into the last of them
+  const size_t merged = batch.size() - depth;
+  batch[merged] = ComposeOdometry(
+      std::span<const OdometryObservation>{batch}.first(merged + 1), registry);
+  batch.erase(batch.begin(), std::next(batch.begin(), merged));
+  return merged;
+}
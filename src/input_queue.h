@@ -0,0 +1,99 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <vector>
+
+#include "gtsam_utils.h"
+#include "model_registry.h"
+
+/**
+ * Overflow policies for what a listener reads off its NT queue each cycle,
+ * so a stalled cycle can't hand the next one a backlog that stalls it too.
+ */
+
+/**
+ * What the listeners have thrown away or merged so far, and what came in
+ * too late for the reorder window. Cumulative
+ */
+struct InputQueueStats {
+  int64_t odomDropped = 0;
+  int64_t odomCoalesced = 0;
+  // In config order
+  std::vector<int64_t> cameraDroppedFrames;
+  // Odometry older than a state already added, dropped
+  int64_t odomStragglers = 0;
+  // Vision released by the reorder buffers after their window had closed
+  std::vector<int64_t> cameraStragglers;
+};
+
+// What an unbounded (depth 0) listener asks NT to hold. NT can't be told to
+// keep everything, so this is just deep: 40s of 250Hz odometry
+constexpr unsigned int kUnboundedPollStorage = 10000;
+
+/**
+ * NT queue size for a listener that takes at most depth entries a cycle. NT
+ * silently drops anything past it, so leave headroom over our own depth for
+ * the overflow counters to see. 0 (or less) is unbounded
+ */
+unsigned int PollStorageFor(int depth);
+
+/**
+ * Keep only the newest depth entries of a batch (oldest first). 0 keeps
+ * everything
+ *
+ * @return how many were dropped
+ */
+template <typename T> size_t DropOldest(std::vector<T> &batch, size_t depth) {
+  if (depth == 0 || batch.size() <= depth) {
+    return 0;
+  }
+  const size_t dropped = batch.size() - depth;
+  batch.erase(batch.begin(), std::next(batch.begin(), dropped));
+  return dropped;
+}
+
+/**
+ * One delta covering a run of consecutive ones (oldest first), ending at the
+ * last one's timestamp. Its noise is each piece's covariance carried through
+ * the pieces after it into the last one's frame and summed, and is interned in
+ * registry
+ */
+OdometryObservation ComposeOdometry(std::span<const OdometryObservation> run,
+                                    ModelRegistry &registry);
+
+/**
+ * Compose the oldest odometry deltas into one until at most depth are left.
+ * No motion is lost, just the states in between (see ComposeOdometry). 0
+ * keeps everything
+ *
+ * @return how many deltas were merged away
+ */
+size_t CoalesceOdometry(std::vector<OdometryObservation> &batch, size_t depth,
+                        ModelRegistry &registry);
@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "latency_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Signed, so a publisher with a bad clock shows up as negative instead of
+// wrapping around
+double ElapsedMs(uint64_t fromUs, uint64_t toUs) {
+  return (static_cast<int64_t>(toUs) - static_cast<int64_t>(fromUs)) / 1000.0;
+}
+
+LatencyPercentiles Summarize(const RollingPercentiles &samples) {
+  return {samples.Percentile(0.5), samples.Percentile(0.99)};
+}
+} // namespace
+
+RollingPercentiles::RollingPercentiles(size_t capacity) : capacity(capacity) {
+  samples.reserve(capacity);
+  scratch.reserve(capacity);
+}
+
+void RollingPercentiles::Add(double sample) {
+  if (samples.size() < capacity) {
+    samples.push_back(sample);
+    return;
+  }
+  samples[next] = sample;
+  next = (next + 1) % capacity;
+}
+
+double RollingPercentiles::Percentile(double q) const {
+  if (samples.empty()) {
+    return 0;
+  }
+
+  scratch.assign(samples.begin(), samples.end());
+  const auto rank = static_cast<size_t>(
+      std::ceil(std::clamp(q, 0.0, 1.0) * scratch.size()));
+  const auto nth = scratch.begin() + (rank > 0 ? rank - 1 : 0);
+  std::nth_element(scratch.begin(), nth, scratch.end());
+  return *nth;
+}
+
+LatencyTracker::LatencyTracker(size_t numCameras, size_t window)
+    : window(window), pending(numCameras), odomAge(window), odomQueue(window),
+      visionAge(window), cameraLatency(numCameras, RollingPercentiles{window}),
+      cameraQueue(numCameras, RollingPercentiles{window}) {}
+
+void LatencyTracker::AddOdometry(const OdometryObservation &odom) {
+  if (odom.timeUs >= newestOdomCaptureUs) {
+    newestOdomCaptureUs = odom.timeUs;
+    newestOdomReadUs = odom.readUs;
+  }
+}
+
+void LatencyTracker::AddVision(
+    const std::vector<std::vector<CameraVisionObservation>> &perCamera) {
+  for (size_t i = 0; i < perCamera.size() && i < pending.size(); i++) {
+    // Every tag in a frame shares its timestamp, so one entry per frame
+    for (const auto &obs : perCamera[i]) {
+      if (pending[i].empty() || pending[i].back().captureUs != obs.timeUs) {
+        pending[i].push_back({obs.timeUs, obs.readUs});
+      }
+      newestVisionCaptureUs = std::max(newestVisionCaptureUs, obs.timeUs);
+    }
+    if (pending[i].size() > window) {
+      pending[i].erase(pending[i].begin(),
+                       pending[i].end() - static_cast<std::ptrdiff_t>(window));
+    }
+  }
+}
+
+void LatencyTracker::Published(uint64_t publishUs) {
+  if (newestOdomCaptureUs > 0) {
+    odomAge.Add(ElapsedMs(newestOdomCaptureUs, publishUs));
+    odomQueue.Add(ElapsedMs(newestOdomReadUs, publishUs));
+  }
+  if (newestVisionCaptureUs > 0) {
+    visionAge.Add(ElapsedMs(newestVisionCaptureUs, publishUs));
+  }
+
+  for (size_t i = 0; i < pending.size(); i++) {
+    for (const Frame &frame : pending[i]) {
+      cameraLatency[i].Add(ElapsedMs(frame.captureUs, publishUs));
+      cameraQueue[i].Add(ElapsedMs(frame.readUs, publishUs));
+    }
+    pending[i].clear();
+  }
+}
+
+LatencyPercentiles LatencyTracker::OdomAge() const {
+  return Summarize(odomAge);
+}
+
+LatencyPercentiles LatencyTracker::OdomQueueDelay() const {
+  return Summarize(odomQueue);
+}
+
+LatencyPercentiles LatencyTracker::VisionAge() const {
+  return Summarize(visionAge);
+}
+
+LatencyPercentiles LatencyTracker::CameraLatency(size_t camera) const {
+  return Summarize(cameraLatency.at(camera));
+}
+
+LatencyPercentiles LatencyTracker::CameraQueueDelay(size_t camera) const {
+  return Summarize(cameraQueue.at(camera));
+}
@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gtsam_utils.h"
+
+/**
+ * The last N samples of something, with percentiles over them
+ */
+class RollingPercentiles {
+public:
+  explicit RollingPercentiles(size_t capacity = 256);
+
+  void Add(double sample);
+
+  /**
+   * Nearest-rank percentile of the samples we're holding, q in [0, 1]. 0 if
+   * we have none
+   */
+  double Percentile(double q) const;
+
+  inline size_t Size() const { return samples.size(); }
+
+private:
+  size_t capacity;
+  // Ring buffer once full, next is the oldest
+  std::vector<double> samples;
+  size_t next = 0;
+  // Reused by Percentile so we don't allocate every publish
+  mutable std::vector<double> scratch;
+};
+
+struct LatencyPercentiles {
+  double p50Ms = 0;
+  double p99Ms = 0;
+};
+
+/**
+ * How old our output is by the time it goes out, which is what robot code
+ * actually sees. Unlike GetLastOptimizeMs() this counts everything from
+ * capture on: transport to us, the reorder window, and time queued before a
+ * cycle picked it up.
+ *
+ * Times are NT microseconds (nt::Now()), the same base observation
+ * timestamps are in.
+ */
+class LatencyTracker {
+public:
+  explicit LatencyTracker(size_t numCameras, size_t window = 256);
+
+  /**
+   * Odometry that just went into the engine
+   */
+  void AddOdometry(const OdometryObservation &odom);
+
+  /**
+   * Vision that just went into the engine, one list per camera in config
+   * order
+   */
+  void AddVision(
+      const std::vector<std::vector<CameraVisionObservation>> &perCamera);
+
+  /**
+   * We just published a pose including everything added so far
+   */
+  void Published(uint64_t publishUs);
+
+  // Newest odometry capture -> publish
+  LatencyPercentiles OdomAge() const;
+  // Newest odometry read off NT -> publish
+  LatencyPercentiles OdomQueueDelay() const;
+  // Newest vision capture (any camera) -> publish. Keeps growing while no
+  // tags are in view
+  LatencyPercentiles VisionAge() const;
+  // Capture -> first publish including it, for every frame from a camera
+  LatencyPercentiles CameraLatency(size_t camera) const;
+  // Same, but from when the frame was read off NT
+  LatencyPercentiles CameraQueueDelay(size_t camera) const;
+
+  inline size_t NumCameras() const { return cameraLatency.size(); }
+
+private:
+  struct Frame {
+    uint64_t captureUs;
+    uint64_t readUs;
+  };
+
+  size_t window;
+  // Frames added since the last publish, per camera. Only the newest window
+  // of them would fit in the percentiles, so that's all we hold while
+  // nothing is being published
+  std::vector<std::vector<Frame>> pending;
+
+  uint64_t newestOdomCaptureUs = 0;
+  uint64_t newestOdomReadUs = 0;
+  uint64_t newestVisionCaptureUs = 0;
+
+  RollingPercentiles odomAge;
+  RollingPercentiles odomQueue;
+  RollingPercentiles visionAge;
+  std::vector<RollingPercentiles> cameraLatency;
+  std::vector<RollingPercentiles> cameraQueue;
+};
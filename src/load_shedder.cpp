@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "load_shedder.h"
+
+#include <gtsam/geometry/CalibratedCamera.h>
+
+#include <cmath>
+#include <limits>
+#include <optional>
+
+#include <Eigen/Cholesky>
+
+using namespace gtsam;
+
+namespace {
+struct Candidate {
+  size_t camera;
+  size_t index;
+  // Whitened corner Jacobian, 2 rows per corner. Empty if we couldn't score
+  // it (unknown tag, or behind the camera from where we think we are)
+  Matrix J;
+  bool kept = false;
+};
+
+std::optional<Matrix> WhitenedJacobian(const CameraVisionObservation &obs,
+                                       const TagModel &tagModel,
+                                       const Pose3 &worldTbody) {
+  const auto worldPcorners = tagModel.WorldToCorners(obs.tagID);
+  if (!worldPcorners || worldPcorners->empty()) {
+    return std::nullopt;
+  }
+
+  Matrix6 Dbody;
+  const Pose3 worldTcamera = worldTbody.compose(obs.robotTcamera, Dbody);
+  const SharedNoiseModel &noise = *obs.cameraNoise;
+
+  Matrix J(2 * worldPcorners->size(), 6);
+  for (size_t i = 0; i < worldPcorners->size(); i++) {
+    Matrix36 Dcamera;
+    const Point3 cameraP =
+        worldTcamera.transformTo((*worldPcorners)[i], Dcamera);
+    if (cameraP.z() <= 1e-6) {
+      return std::nullopt;
+    }
+    Matrix23 Dpoint;
+    PinholeBase::Project(cameraP, Dpoint);
+    J.block<2, 6>(2 * i, 0) = noise->Whiten(Dpoint * Dcamera * Dbody);
+  }
+  return J;
+}
+} // namespace
+
+LoadShedder::LoadShedder(const LoadSheddingConfig &config) : config(config) {}
+
+SheddingStats
+LoadShedder::Apply(std::vector<std::vector<CameraVisionObservation>> &perCamera,
+                   const TagModel &tagModel,
+                   const LocalizerEngine &engine) const {
+  size_t pending = 0;
+  for (const auto &camera : perCamera) {
+    pending += camera.size();
+  }
+
+  const auto maxTags = static_cast<size_t>(config.maxTags);
+  const auto pendingBudget =
+      config.pendingBudget > 0 ? static_cast<size_t>(config.pendingBudget)
+                               : maxTags;
+  const bool slow = config.optimizeBudgetMs > 0 &&
+                    engine.GetLastOptimizeMs() > config.optimizeBudgetMs;
+  if (maxTags == 0 || pending <= maxTags ||
+      (pending <= pendingBudget && !slow)) {
+    return {pending, 0};
+  }
+
+  return Select(perCamera, tagModel, engine.GetLatestWorldToBody(),
+                engine.GetLatestMarginals(), maxTags);
+}
+
+SheddingStats LoadShedder::Select(
+    std::vector<std::vector<CameraVisionObservation>> &perCamera,
+    const TagModel &tagModel, const Pose3 &worldTbody, const Matrix &covariance,
+    size_t maxTags) {
+  SheddingStats stats;
+  for (const auto &camera : perCamera) {
+    stats.kept += camera.size();
+  }
+  if (stats.kept <= maxTags) {
+    return stats;
+  }
+
+  std::vector<Candidate> candidates;
+  candidates.reserve(stats.kept);
+  for (size_t c = 0; c < perCamera.size(); c++) {
+    for (size_t i = 0; i < perCamera[c].size(); i++) {
+      const auto J = WhitenedJacobian(perCamera[c][i], tagModel, worldTbody);
+      candidates.push_back({c, i, J.value_or(Matrix{})});
+    }
+  }
+
+  // Greedy, updating P as we go
+  Matrix P = covariance;
+  size_t picked = 0;
+  for (; picked < maxTags; picked++) {
+    Candidate *best = nullptr;
+    double bestGain = -std::numeric_limits<double>::infinity();
+    for (Candidate &candidate : candidates) {
+      if (candidate.kept || candidate.J.size() == 0) {
+        continue;
+      }
+      const Matrix &J = candidate.J;
+      const Matrix S =
+          Matrix::Identity(J.rows(), J.rows()) + J * P * J.transpose();
+      const Eigen::LLT<Matrix> llt(S);
+      if (llt.info() != Eigen::Success) {
+        continue;
+      }
+      const double gain = 2 * llt.matrixLLT().diagonal().array().log().sum();
+      if (gain > bestGain) {
+        bestGain = gain;
+        best = &candidate;
+      }
+    }
+    if (!best) {
+      break;
+    }
+
+    best->kept = true;
+    const Matrix &J = best->J;
+    const Matrix PJt = P * J.transpose();
+    const Matrix S = Matrix::Identity(J.rows(), J.rows()) + J * PJt;
+    P -= PJt * S.llt().solve(PJt.transpose());
+  }
+
+  // Anything we couldn't score only gets leftover slots
+  for (Candidate &candidate : candidates) {
+    if (picked >= maxTags) {
+      break;
+    }
+    if (!candidate.kept && candidate.J.size() == 0) {
+      candidate.kept = true;
+      picked++;
+    }
+  }
+
+  // Candidates are in camera, then observation order
+  std::vector<std::vector<CameraVisionObservation>> kept(perCamera.size());
+  for (const Candidate &candidate : candidates) {
+    if (candidate.kept) {
+      kept[candidate.camera].push_back(
+          std::move(perCamera[candidate.camera][candidate.index]));
+    }
+  }
+  perCamera = std::move(kept);
+
+  stats.dropped = stats.kept - picked;
+  stats.kept = picked;
+  return stats;
+}
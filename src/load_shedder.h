@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Pose3.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "TagModel.h"
+#include "config.h"
+#include "gtsam_utils.h"
+#include "localizer_engine.h"
+
+struct SheddingStats {
+  // Tag observations this cycle that went into the engine
+  size_t kept = 0;
+  // and those we threw away for being over budget
+  size_t dropped = 0;
+};
+
+/**
+ * Keeps the vision we add each cycle within what Optimize() can absorb.
+ *
+ * Once over budget, observations are picked greedily by expected information
+ * gain, log det(I + J P J^T): J is the observation's whitened corner Jacobian
+ * with respect to the body pose, at our latest estimate, and P is that
+ * estimate's covariance. Distance, viewing angle and tag size all show up
+ * in J, and P makes directions we're already sure of worth less. After each
+ * pick P is updated as if it had been added, so several tags that all pin
+ * down the same direction don't crowd out one that pins down another.
+ */
+class LoadShedder {
+public:
+  explicit LoadShedder(const LoadSheddingConfig &config);
+
+  /**
+   * Drop all but the most useful observations if this cycle is over budget,
+   * scoring them against engine's latest estimate. That's only fetched if
+   * we're shedding, since the covariance isn't free.
+   */
+  SheddingStats
+  Apply(std::vector<std::vector<CameraVisionObservation>> &perCamera,
+        const TagModel &tagModel, const LocalizerEngine &engine) const;
+
+  /**
+   * Keep the maxTags most useful observations, regardless of budget. Order
+   * within each camera is kept.
+   *
+   * @param covariance of worldTbody, in order [rx ry rz tx ty tz]
+   */
+  static SheddingStats
+  Select(std::vector<std::vector<CameraVisionObservation>> &perCamera,
+         const TagModel &tagModel, const gtsam::Pose3 &worldTbody,
+         const gtsam::Matrix &covariance, size_t maxTags);
+
+private:
+  LoadSheddingConfig config;
+};
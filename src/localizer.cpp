@@ -24,28 +24,33 @@
 
 #include "localizer.h"
 
-#include "TagModel.h"
+#include <gtsam/inference/VariableIndex.h>
+
+#include <algorithm>
+#include <chrono>
+
 #include "gtsam/nonlinear/Expression.h"
+#include "pnp.h"
 
 using namespace gtsam;
 using symbol_shorthand::X;
 
 constexpr int NUM_CORNERS = 4;
-
-Localizer::Localizer() {
-  ISAM2Params parameters;
-  // parameters.relinearizeThreshold = 0.01;
-  // parameters.relinearizeSkip = 1;
-  // parameters.cacheLinearizedFactors = false;
-  // parameters.enableDetailedResults = true;
-  parameters.findUnusedFactorSlots = true;
-  parameters.print();
+// If the IMU goes quiet for longer than this, stop assuming it's still
+// reading what it last read
+constexpr uint64_t MAX_GYRO_HOLD_US = 20 * 1000;
+
+Localizer::Localizer(const LocalizerOptions &options)
+    : framePoseFactors(options.framePoseFactors),
+      reprojectionDiagnostics(options.reprojectionDiagnostics) {
+  if (options.planar) {
+    planar.emplace(*options.planar);
+  }
 
   // TODO: make sure that timestamps in units of uS doesn't cause numerical
   // precision issues
-  double lag = 5 * 1e6;
-  // double lag = 2;
-  smootherISAM2 = IncrementalFixedLagSmoother(lag, parameters);
+  smoother = MakeSmootherBackend(options.smoother, options.lagUs,
+                                 options.isam2, options.pool);
 
   // // And make sure to call optimize first to get values
   // TODO i killed maybe needed, idk
@@ -58,37 +63,170 @@ void Localizer::Reset(Pose3 wTr, SharedNoiseModel noise, uint64_t timeUs) {
   timeUs -= 1;
 
   currStateIdx = X(timeUs);
+  latestOdomTime = timeUs;
 
-  smootherISAM2 = IncrementalFixedLagSmoother(smootherISAM2.smootherLag(),
-                                              smootherISAM2.params());
+  smoother->Clear();
 
   graph.resize(0);
   currentEstimate.clear();
   newTimestamps.clear();
   factorsToRemove.clear();
   twistsFromPreviousKey.clear();
+  pendingVisionFactors = 0;
+  diagnostics.Clear();
+  lastReprojection = {};
+
+  if (gyroPreintegrated) {
+    gyroPreintegrated->resetIntegration();
+  }
+  imuIntegratedUntil = timeUs;
 
-  graph.addPrior(currStateIdx, wTr, noise);
-  currentEstimate.insert(currStateIdx, wTr);
+  if (planar) {
+    graph.addPrior(currStateIdx, PlanarLift::Flatten(wTr),
+                   PlanarLift::FlattenNoise(noise));
+  } else {
+    graph.addPrior(currStateIdx, wTr, noise);
+  }
+  wTb_latest = InsertEstimate(currStateIdx, wTr);
   newTimestamps[currStateIdx] = timeUs;
+}
+
+Pose3_ Localizer::StateExpression(Key key) const {
+  if (planar) {
+    return planar->Lift(Pose2_(key));
+  }
+  return Pose3_(key);
+}
+
+Pose3 Localizer::CalculatePose(Key key) const {
+  if (planar) {
+    return planar->Lift(smoother->CalculatePose2(key));
+  }
+  return smoother->CalculatePose(key);
+}
+
+Pose3 Localizer::InsertEstimate(Key key, const Pose3 &worldTbody) {
+  if (planar) {
+    const Pose2 flat = PlanarLift::Flatten(worldTbody);
+    currentEstimate.insert(key, flat);
+    return planar->Lift(flat);
+  }
+  currentEstimate.insert(key, worldTbody);
+  return worldTbody;
+}
+
+void Localizer::AddBetween(Key from, Key to, const Pose3 &delta,
+                           const SharedNoiseModel &noise) {
+  if (!planar) {
+    graph.emplace_shared<BetweenFactor<Pose3>>(from, to, delta, noise);
+    return;
+  }
+
+  auto flatNoise = planarNoise.find(noise);
+  if (flatNoise == planarNoise.end()) {
+    flatNoise =
+        planarNoise.emplace(noise, PlanarLift::FlattenNoise(noise)).first;
+  }
+  graph.emplace_shared<BetweenFactor<Pose2>>(
+      from, to, PlanarLift::Flatten(delta), flatNoise->second);
+}
+
+void Localizer::SetTagLayout(const frc::AprilTagFieldLayout &layout) {
+  tagModel.SetLayout(layout);
+}
+
+void Localizer::EnableImu(const ImuConfig &config) {
+  auto params = std::make_shared<PreintegratedRotationParams>();
+  params->setGyroscopeCovariance(I_3x3 * config.gyroNoiseDensity *
+                                 config.gyroNoiseDensity);
+  params->setBodyPSensor(Pose3{
+      Rot3::RzRyRx(config.robotRimu[0], config.robotRimu[1],
+                   config.robotRimu[2]),
+      Point3::Zero()});
+
+  gyroPreintegrated.emplace(
+      params,
+      Vector3{config.gyroBias[0], config.gyroBias[1], config.gyroBias[2]});
+  imuQueueDepth = static_cast<size_t>(std::max(1, config.queueDepth));
+}
+
+void Localizer::AddImu(const ImuObservation &imu) {
+  if (!gyroPreintegrated) {
+    return;
+  }
+  imuQueue.push_back(imu);
+  if (imuQueue.size() > imuQueueDepth) {
+    imuQueue.pop_front();
+    DroppedImu("queue full");
+  }
+}
+
+void Localizer::DroppedImu(std::string_view why) {
+  // Once, then every so often, so a backed up queue doesn't flood the console
+  if (droppedImu++ % 1000 == 0) {
+    fmt::println("Dropped gyro reading ({}), {} so far", why, droppedImu);
+  }
+}
+
+void Localizer::AddGyroFactor(Key lower, Key upper, uint64_t timeUs) {
+  PreintegratedAhrsMeasurements &preint = *gyroPreintegrated;
+
+  while (!imuQueue.empty() && imuQueue.front().timeUs <= timeUs) {
+    const ImuObservation &imu = imuQueue.front();
+    // anything from before our last state (or our prior) is just dropped
+    if (imu.timeUs > imuIntegratedUntil) {
+      preint.integrateMeasurement(imu.gyro,
+                                  (imu.timeUs - imuIntegratedUntil) * 1e-6);
+      imuIntegratedUntil = imu.timeUs;
+    } else {
+      DroppedImu("late");
+    }
+    lastGyro = imu.gyro;
+    lastGyroTime = imu.timeUs;
+    imuQueue.pop_front();
+  }
+
+  // Carry the last reading up to the state boundary, so the next interval
+  // starts exactly where this one ends
+  if (timeUs > imuIntegratedUntil && lastGyroTime > 0 &&
+      timeUs - lastGyroTime < MAX_GYRO_HOLD_US) {
+    preint.integrateMeasurement(lastGyro,
+                                (timeUs - imuIntegratedUntil) * 1e-6);
+  }
+  imuIntegratedUntil = std::max(imuIntegratedUntil, timeUs);
+
+  if (preint.deltaTij() <= 0) {
+    // no readings this interval
+    return;
+  }
 
-  wTb_latest = wTr;
+  const Rot3_ worldRlower = rotation(StateExpression(lower));
+  const Rot3_ worldRupper = rotation(StateExpression(upper));
+  graph.addExpressionFactor(
+      between(worldRlower, worldRupper), preint.deltaRij(),
+      noiseModel::Gaussian::Covariance(preint.preintMeasCov()));
+
+  preint.resetIntegration();
 }
 
-void Localizer::AddOdometry(OdometryObservation odom) {
+void Localizer::AddOdometry(const OdometryObservation &odom) {
   const Pose3 &poseDelta = odom.poseDelta;
-  const SharedNoiseModel &odometryNoise = odom.odometryNoise;
+  const SharedNoiseModel &odometryNoise = *odom.odometryNoise;
   uint64_t timeUs = odom.timeUs;
 
   Key newStateIdx = X(timeUs);
 
   // Add an odometry pose delta from our last state to our new one
-  graph.emplace_shared<BetweenFactor<Pose3>>(currStateIdx, newStateIdx,
-                                             poseDelta, odometryNoise);
+  AddBetween(currStateIdx, newStateIdx, poseDelta, odometryNoise);
+
+  // And the gyro's take on how much we rotated over the same interval
+  if (gyroPreintegrated) {
+    AddGyroFactor(currStateIdx, newStateIdx, timeUs);
+  }
 
   // And get initial guess just by composing previous pose
-  wTb_latest = wTb_latest.transformPoseFrom(poseDelta);
-  currentEstimate.insert(newStateIdx, wTb_latest);
+  wTb_latest =
+      InsertEstimate(newStateIdx, wTb_latest.transformPoseFrom(poseDelta));
 
   newTimestamps[newStateIdx] = timeUs;
   twistsFromPreviousKey[newStateIdx] = poseDelta;
@@ -105,10 +243,8 @@ Key Localizer::InsertIntoSmoother(Key lower, Key upper, Key newKey,
    * it with 2 new factors and an intermediatestate
    */
 
-  const VariableIndex &variableIndex =
-      smootherISAM2.getISAM2().getVariableIndex();
-  const NonlinearFactorGraph &currentFactors =
-      smootherISAM2.getISAM2().getFactorsUnsafe();
+  const NonlinearFactorGraph currentFactors = smoother->Factors();
+  const VariableIndex variableIndex{currentFactors};
 
   // FastMap<Key, FactorIndices>::const_iterator
   const auto &factorsConnectedToUpper = variableIndex.find(upper);
@@ -151,16 +287,13 @@ Key Localizer::InsertIntoSmoother(Key lower, Key upper, Key newKey,
         // And add odometry pose deltas
         Pose3 deltaLowerToMid = Pose3::Expmap(twistLowerToMid);
         Pose3 deltaMidToHigh = Pose3::Expmap(twistLowerToMid);
-        graph.emplace_shared<BetweenFactor<Pose3>>(
-            lower, newKey, deltaLowerToMid, odometryNoise);
-        graph.emplace_shared<BetweenFactor<Pose3>>(
-            newKey, upper, deltaMidToHigh, odometryNoise);
+        AddBetween(lower, newKey, deltaLowerToMid, odometryNoise);
+        AddBetween(newKey, upper, deltaMidToHigh, odometryNoise);
 
         // and add estimates
-        Pose3 currentWorldToLower =
-            smootherISAM2.calculateEstimate<Pose3>(lower);
-        currentEstimate.insert(
-            newKey, currentWorldToLower.transformPoseFrom(deltaLowerToMid));
+        Pose3 currentWorldToLower = CalculatePose(lower);
+        InsertEstimate(newKey,
+                       currentWorldToLower.transformPoseFrom(deltaLowerToMid));
         newTimestamps[newKey] = newTime;
         twistsFromPreviousKey[newKey] = deltaLowerToMid;
         twistsFromPreviousKey[upper] = deltaMidToHigh;
@@ -186,10 +319,26 @@ static KeyTimeConstIt FindCloser(KeyTimeConstIt left, KeyTimeConstIt right,
   }
 }
 
-Key Localizer::GetOrInsertKey(Key newKey, double time) {
+Key Localizer::GetOrInsertKey(Key newKey, double time) const {
   using KeyTimeMap = FixedLagSmoother::KeyTimestampMap;
 
-  const KeyTimeMap &isamTimestamps = smootherISAM2.timestamps();
+  const KeyTimeMap &isamTimestamps = smoother->Timestamps();
+  // Landing exactly on a state (eg vision captured with the odometry) just
+  // uses it
+  if (isamTimestamps.contains(newKey) || newTimestamps.contains(newKey)) {
+    return newKey;
+  }
+
+  // Nothing's been optimized since the reset, so it's all yet-to-be-added
+  if (isamTimestamps.empty()) {
+    const auto notAddedAfter = newTimestamps.upper_bound(newKey);
+    if (notAddedAfter == newTimestamps.begin() ||
+        notAddedAfter == newTimestamps.end()) {
+      throw std::runtime_error("Timestamp outside yet-to-be-added history");
+    }
+    return FindCloser(std::prev(notAddedAfter), notAddedAfter, time)->first;
+  }
+
   const auto &isamEntryAfter = isamTimestamps.upper_bound(newKey);
   if (isamEntryAfter == isamTimestamps.begin()) {
     throw std::runtime_error("Timestamp is before even isam history");
@@ -204,7 +353,7 @@ Key Localizer::GetOrInsertKey(Key newKey, double time) {
     return FindCloser(isamEntryBefore, isamEntryAfter, time)->first;
   }
 
-  KeyTimeMap::iterator notAddedAfter = newTimestamps.upper_bound(newKey);
+  KeyTimeMap::const_iterator notAddedAfter = newTimestamps.upper_bound(newKey);
 
   if (notAddedAfter == newTimestamps.end()) {
     throw std::runtime_error(
@@ -221,7 +370,7 @@ Key Localizer::GetOrInsertKey(Key newKey, double time) {
         "Timestamp is before not-added but not after isam history?");
   }
 
-  KeyTimeMap::iterator notAddedBefore = std::prev(notAddedAfter);
+  KeyTimeMap::const_iterator notAddedBefore = std::prev(notAddedAfter);
 
   if (isamEntryAfter != isamTimestamps.end() &&
       isamEntryBefore->second < time) {
@@ -379,44 +528,193 @@ Key Localizer::GetOrInsertKey(Key newKey, double time) {
   // }
 }
 
-void Localizer::AddTagObservation(CameraVisionObservation obs) {
-  const auto &isamTimestamps = smootherISAM2.timestamps();
-  if (obs.timeUs < isamTimestamps.begin()->second) {
-    std::cerr << "Timestamp is before even isam history - skipping" << std::endl;
+void Localizer::AddTagObservation(const CameraVisionObservation &obs) {
+  if (framePoseFactors) {
+    AddFrameFactors({{obs}}, nullptr);
+    return;
+  }
+
+  const size_t before = graph.size();
+  if (const Key state = BuildTagFactors(obs, graph)) {
+    RecordForDiagnostics(obs, state);
+  }
+  pendingVisionFactors += graph.size() - before;
+}
+
+void Localizer::AddTagObservations(
+    const std::vector<std::vector<CameraVisionObservation>> &perCamera,
+    WorkerPool &pool) {
+  if (framePoseFactors) {
+    AddFrameFactors(perCamera, &pool);
     return;
   }
 
+  std::vector<ExpressionFactorGraph> batches(perCamera.size());
+  // Which state each observation ended up on
+  std::vector<std::vector<Key>> states(perCamera.size());
+
+  pool.ParallelFor(perCamera.size(), [&](size_t i) {
+    states[i].reserve(perCamera[i].size());
+    for (const auto &obs : perCamera[i]) {
+      states[i].push_back(BuildTagFactors(obs, batches[i]));
+    }
+  });
+
+  for (size_t i = 0; i < perCamera.size(); i++) {
+    AddFactors(batches[i]);
+    // Only BuildTagFactors wrote to these
+    pendingVisionFactors += batches[i].size();
+    for (size_t j = 0; j < perCamera[i].size(); j++) {
+      if (states[i][j]) {
+        RecordForDiagnostics(perCamera[i][j], states[i][j]);
+      }
+    }
+  }
+}
+
+void Localizer::AddFrameFactors(
+    const std::vector<std::vector<CameraVisionObservation>> &perCamera,
+    WorkerPool *pool) {
+  // Group into frames and look up their states here, so the solves below
+  // only ever read
+  std::vector<std::vector<Frame>> frames(perCamera.size());
+  for (size_t i = 0; i < perCamera.size(); i++) {
+    std::map<uint64_t, std::vector<CameraVisionObservation>> byTime;
+    for (const auto &obs : perCamera[i]) {
+      byTime[obs.timeUs].push_back(obs);
+    }
+    for (auto &[timeUs, observations] : byTime) {
+      const Key state = FindStateFor(timeUs);
+      if (state) {
+        frames[i].push_back(
+            {state, StateGuess(state), std::move(observations)});
+      }
+    }
+  }
+
+  std::vector<ExpressionFactorGraph> batches(perCamera.size());
+  // not vector<bool>, we write these from several threads
+  std::vector<std::vector<char>> added(perCamera.size());
+  const auto build = [&](size_t i) {
+    added[i].reserve(frames[i].size());
+    for (const auto &frame : frames[i]) {
+      added[i].push_back(BuildFrameFactor(frame, batches[i]));
+    }
+  };
+  if (pool) {
+    pool->ParallelFor(perCamera.size(), build);
+  } else {
+    for (size_t i = 0; i < perCamera.size(); i++) {
+      build(i);
+    }
+  }
+
+  for (size_t i = 0; i < perCamera.size(); i++) {
+    AddFactors(batches[i]);
+    for (size_t j = 0; j < frames[i].size(); j++) {
+      if (!added[i][j]) {
+        continue;
+      }
+      // One pose factor per frame
+      pendingVisionFactors++;
+      for (const auto &obs : frames[i][j].observations) {
+        RecordForDiagnostics(obs, frames[i][j].state);
+      }
+    }
+  }
+}
+
+bool Localizer::BuildFrameFactor(const Frame &frame,
+                                 ExpressionFactorGraph &out) const {
+  const Pose3 &robotTcamera = frame.observations.front().robotTcamera;
+
+  const auto worldTcamera = pnp::RefineCameraPose(
+      frame.observations, tagModel, frame.worldTbody * robotTcamera);
+  if (!worldTcamera) {
+    return false;
+  }
+
+  const Pose3_ worldTcamera_fac(StateExpression(frame.state),
+                                &Pose3::transformPoseFrom,
+                                Pose3_(robotTcamera));
+  out.addExpressionFactor(worldTcamera_fac, worldTcamera->pose,
+                          worldTcamera->noise);
+  return true;
+}
+
+Pose3 Localizer::StateGuess(Key key) const {
+  if (currentEstimate.exists(key)) {
+    if (planar) {
+      return planar->Lift(currentEstimate.at<Pose2>(key));
+    }
+    return currentEstimate.at<Pose3>(key);
+  }
+  return CalculatePose(key);
+}
+
+void Localizer::RecordForDiagnostics(const CameraVisionObservation &obs,
+                                     Key state) {
+  if (!reprojectionDiagnostics) {
+    return;
+  }
+  const auto worldPcorners = tagModel.WorldToCorners(obs.tagID);
+  if (!worldPcorners) {
+    return;
+  }
+  const Vector sigmas = (*obs.cameraNoise)->sigmas();
+  diagnostics.Add(state, obs.cameraIndex, obs.tagID, obs.robotTcamera,
+                  *worldPcorners, obs.corners, Vector2{sigmas(0), sigmas(1)});
+}
+
+void Localizer::AddFactors(const NonlinearFactorGraph &factors) {
+  graph.push_back(factors.begin(), factors.end());
+}
+
+Key Localizer::FindStateFor(uint64_t timeUs) const {
+  const auto &isamTimestamps = smoother->Timestamps();
+  if (!isamTimestamps.empty() && timeUs < isamTimestamps.begin()->second) {
+    std::cerr << "Timestamp is before even isam history - skipping" << std::endl;
+    return 0;
+  }
+
+  // Find where we should attach our new factors to
+  return GetOrInsertKey(X(timeUs), timeUs);
+}
+
+Key Localizer::BuildTagFactors(const CameraVisionObservation &obs,
+                               ExpressionFactorGraph &out) const {
   int tagID = obs.tagID;
-  const Cal3_S2_ &cameraCal = obs.cameraCal;
   const Pose3 &robotTcamera = obs.robotTcamera;
   const std::vector<Point2> &corners = obs.corners;
-  const SharedNoiseModel cameraNoise = obs.cameraNoise;
+  const SharedNoiseModel &cameraNoise = *obs.cameraNoise;
   const uint64_t timeUs = obs.timeUs;
 
-  auto worldPcorners_opt = TagModel::WorldToCorners(tagID);
+  auto worldPcorners_opt = tagModel.WorldToCorners(tagID);
   if (!worldPcorners_opt) {
     // todo return bad thing
     fmt::println("Could not find tag {} in our map!", tagID);
-    return;
+    return 0;
   }
   auto worldPcorners = worldPcorners_opt.value();
 
-  Key newKey = X(timeUs);
-
-  // Find where we should attach our new factors to
-  Key stateAtTime = GetOrInsertKey(newKey, timeUs);
+  Key stateAtTime = FindStateFor(timeUs);
+  if (!stateAtTime) {
+    return 0;
+  }
 
   for (size_t i = 0; i < NUM_CORNERS; i++) {
-    // corner in image space
+    // corner in normalized image space
     Point2 measurement = corners[i];
 
     // current world->body pose
-    const Pose3_ worldTbody_fac(stateAtTime);
+    const Pose3_ worldTbody_fac = StateExpression(stateAtTime);
     const auto prediction = PredictLandmarkImageLocation(
-        worldTbody_fac, robotTcamera, cameraCal, worldPcorners[i]);
+        worldTbody_fac, robotTcamera, worldPcorners[i]);
 
-    graph.addExpressionFactor(prediction, measurement, cameraNoise);
+    out.addExpressionFactor(prediction, measurement, cameraNoise);
   }
+
+  return stateAtTime;
 }
 
 void Localizer::Optimize() {
@@ -424,7 +722,14 @@ void Localizer::Optimize() {
   // graph.print("New factors: ");
   // currentEstimate.print("New estimates: ");
 
-  smootherISAM2.update(graph, currentEstimate, newTimestamps, factorsToRemove);
+  const auto start = std::chrono::steady_clock::now();
+  smoother->Update(graph, currentEstimate, newTimestamps, factorsToRemove);
+  lastOptimizeMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  lastVisionFactors = pendingVisionFactors;
+  pendingVisionFactors = 0;
 
   // reset the graph; isam wants to be fed factors to be -added-
   graph.resize(0);
@@ -434,11 +739,39 @@ void Localizer::Optimize() {
 
   // And grab the estimate of only the latest pose (maximize laziness)
   // Cache for use with FK prediction when adding odom factors
-  wTb_latest = smootherISAM2.calculateEstimate<Pose3>(currStateIdx);
+  wTb_latest = CalculatePose(currStateIdx);
+
+  // See how well all the vision still in the window fits now
+  const auto &timestamps = smoother->Timestamps();
+  if (!timestamps.empty()) {
+    diagnostics.Prune(timestamps.begin()->first);
+  }
+  if (diagnostics.NumObservations() > 0) {
+    // Only the states vision hangs off, not the whole window. Consecutive
+    // observations are usually on the same state
+    std::optional<Key> lastKey;
+    std::optional<Pose3> lastPose;
+    lastReprojection =
+        diagnostics.Evaluate([&](Key key) -> std::optional<Pose3> {
+          if (key != lastKey) {
+            lastKey = key;
+            lastPose = timestamps.contains(key)
+                           ? std::optional{CalculatePose(key)}
+                           : std::nullopt;
+          }
+          return lastPose;
+        });
+  } else {
+    lastReprojection = {};
+  }
 }
 
 Matrix Localizer::GetLatestMarginals() const {
-  return smootherISAM2.marginalCovariance(GetCurrStateIdx());
+  if (planar) {
+    return planar->LiftCovariance(
+        smoother->MarginalCovariance(GetCurrStateIdx()));
+  }
+  return smoother->MarginalCovariance(GetCurrStateIdx());
 }
 
 Vector6 Localizer::GetPoseComponentStdDevs() const {
@@ -446,30 +779,34 @@ Vector6 Localizer::GetPoseComponentStdDevs() const {
   return marginals.diagonal().cwiseSqrt();
 }
 
-const std::vector<frc::Pose3d> Localizer::GetPoseHistory() const {
+const std::vector<Timestamped<frc::Pose3d>>
+Localizer::GetPoseHistory() const {
   // Plot all history, so grab the whole estimate
-  Values result = smootherISAM2.calculateEstimate();
+  Values result = smoother->CalculateEstimate();
 
   // 5 seconds of history
   auto start = currStateIdx - (5 * 1e6);
 
-  std::vector<frc::Pose3d> ret;
+  std::vector<Timestamped<frc::Pose3d>> ret;
   ret.reserve(1000);
 
   for (const Values::ConstKeyValuePair &estPair : result) {
     if (estPair.key < start)
       continue;
 
-    Pose3 est = estPair.value.cast<Pose3>();
+    const Pose3 est = planar ? planar->Lift(estPair.value.cast<Pose2>())
+                             : estPair.value.cast<Pose3>();
 
     // auto rot = est.rotation().toQuaternion();
     // vector<double> poseEst{est.x(), est.y(), est.z(), rot.w(),
     //                             rot.x(), rot.y(), rot.z()};
 
-    ret.emplace_back(frc::Translation3d{units::meter_t{est.x()},
-                                        units::meter_t{est.y()},
-                                        units::meter_t{est.z()}},
-                     frc::Rotation3d{est.rotation().matrix()});
+    ret.emplace_back(
+        Symbol(estPair.key).index(),
+        frc::Pose3d{frc::Translation3d{units::meter_t{est.x()},
+                                       units::meter_t{est.y()},
+                                       units::meter_t{est.z()}},
+                    frc::Rotation3d{est.rotation().matrix()}});
   }
 
   return ret;
@@ -26,59 +26,166 @@
 
 #include <gtsam/geometry/Cal3_S2.h>
 #include <gtsam/geometry/PinholeCamera.h>
+#include <gtsam/navigation/AHRSFactor.h>
 #include <gtsam/nonlinear/ExpressionFactorGraph.h>
 #include <gtsam/slam/BetweenFactor.h>
 #include <gtsam/slam/SmartProjectionPoseFactor.h>
-#include <gtsam_unstable/nonlinear/IncrementalFixedLagSmoother.h>
 
+#include <deque>
 #include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include <frc/geometry/Pose3d.h>
 #include <units/time.h>
 
+#include "TagModel.h"
+#include "config.h"
 #include "gtsam/slam/expressions.h"
 #include "gtsam_utils.h"
+#include "localizer_engine.h"
+#include "planar.h"
+#include "reprojection_diagnostics.h"
+#include "smoother_backend.h"
 
-class Localizer {
+struct LocalizerOptions {
+  // Which SmootherBackend to use, see MakeSmootherBackend
+  std::string smoother = "isam2";
+  // Ordering/factorization for the isam2 smoother
+  Isam2Config isam2;
+  // If set, keep (x, y, yaw) states on the floor instead of full 3d poses
+  std::optional<PlanarConfig> planar;
+  // Add one camera pose factor per camera frame, instead of one reprojection
+  // factor per tag corner
+  bool framePoseFactors = false;
+  // How much history the smoother keeps, uS. Infinity keeps everything
+  double lagUs = 5 * 1e6;
+  // Re-check every tag observation in the window after each Optimize(), for
+  // GetReprojectionSummary(). Costs a pose lookup per state with vision on it
+  bool reprojectionDiagnostics = true;
+  // Where the "concurrent" smoother runs its background passes. Must outlive
+  // the localizer
+  WorkerPool *pool = nullptr;
+};
+
+class Localizer : public LocalizerEngine {
   using Key = gtsam::Key;
   using SmartFactor = gtsam::SmartProjectionPoseFactor<gtsam::Cal3_S2>;
   using LandmarkMap = std::map<Key, SmartFactor::shared_ptr>;
 
 public:
-  Localizer();
+  explicit Localizer(const LocalizerOptions &options = {});
 
   /**
    * Add a prior factor on the world->robot pose
    */
-  void Reset(gtsam::Pose3 wTr, gtsam::SharedNoiseModel noise, uint64_t timeUs);
+  void Reset(gtsam::Pose3 wTr, gtsam::SharedNoiseModel noise,
+             uint64_t timeUs) override;
+
+  /**
+   * Swap out the field layout used for new tag observations
+   */
+  void SetTagLayout(const frc::AprilTagFieldLayout &layout) override;
+
+  /**
+   * Start preintegrating gyro readings into one rotation factor between each
+   * pair of odometry states
+   */
+  void EnableImu(const ImuConfig &config) override;
+
+  /**
+   * Queue a raw IMU reading. It gets integrated into the factor for whatever
+   * state interval it falls in when the odometry closing that interval is
+   * added, so readings should be added before their odometry.
+   */
+  void AddImu(const ImuObservation &imu) override;
+
+  void AddOdometry(const OdometryObservation &odom) override;
+
+  void AddTagObservation(const CameraVisionObservation &tagDetection) override;
+
+  /**
+   * Builds each camera's factors on its own thread, then merges them in camera
+   * order, so the graph we hand the smoother doesn't depend on thread timing
+   */
+  void AddTagObservations(
+      const std::vector<std::vector<CameraVisionObservation>> &perCamera,
+      WorkerPool &pool) override;
+
+  /**
+   * Build the factors for a tag observation into out, without touching our
+   * pending graph. Only reads localizer state, so several threads can build
+   * at once as long as nobody is adding to the localizer at the same time.
+   *
+   * @return the state the factors hang off, or 0 if we skipped it
+   */
+  Key BuildTagFactors(const CameraVisionObservation &tagDetection,
+                      gtsam::ExpressionFactorGraph &out) const;
+
+  /**
+   * Queue up prebuilt factors (eg from BuildTagFactors) for the next
+   * Optimize(). They aren't counted as vision factors, whatever they are
+   */
+  void AddFactors(const gtsam::NonlinearFactorGraph &factors);
 
-  void AddOdometry(OdometryObservation odom);
+  /**
+   * One camera frame: every tag a camera saw at one capture time, and the
+   * state it lands on
+   */
+  struct Frame {
+    Key state;
+    // Our current guess for that state, to start the solve from
+    gtsam::Pose3 worldTbody;
+    std::vector<CameraVisionObservation> observations;
+  };
 
-  void AddTagObservation(CameraVisionObservation tagDetection);
+  /**
+   * Frame-level alternative to BuildTagFactors: solve for the camera's pose
+   * from every corner in the frame, and add that as a single pose factor on
+   * the frame's state. Same threading rules as BuildTagFactors.
+   *
+   * @return false if the solve didn't fit and we added nothing
+   */
+  bool BuildFrameFactor(const Frame &frame,
+                        gtsam::ExpressionFactorGraph &out) const;
 
-  void Optimize();
+  void Optimize() override;
 
   // inline void ExportGraph(std::ostream& os) {
   //   smootherISAM2.getFactors().saveGraph(os);
   // }
-  inline void Print(const std::string_view prefix = "") {
+  inline void Print(const std::string_view prefix = "") override {
     fmt::println("{}", prefix);
-    smootherISAM2.print();
-    smootherISAM2.getISAM2().getFactorsUnsafe().print();
-    smootherISAM2.calculateEstimate().print("Current estimate:");
+    smoother->Print();
+    smoother->CalculateEstimate().print("Current estimate:");
   }
 
-  inline Key GetCurrStateIdx() const { return currStateIdx; }
-  inline uint64_t GetLastOdomTime() const { return latestOdomTime; }
+  inline const SmootherBackend &GetSmoother() const { return *smoother; }
+
+  inline Key GetCurrStateIdx() const override { return currStateIdx; }
+  inline uint64_t GetLastOdomTime() const override { return latestOdomTime; }
 
-  inline const gtsam::Pose3 GetLatestWorldToBody() const { return wTb_latest; }
+  inline const gtsam::Pose3 GetLatestWorldToBody() const override {
+    return wTb_latest;
+  }
 
-  gtsam::Matrix GetLatestMarginals() const;
+  gtsam::Matrix GetLatestMarginals() const override;
   // standard deviations on rx ry rz tx ty tz
   gtsam::Vector6 GetPoseComponentStdDevs() const;
 
-  const std::vector<frc::Pose3d> GetPoseHistory() const;
+  const std::vector<Timestamped<frc::Pose3d>> GetPoseHistory() const override;
+
+  inline size_t GetLastVisionFactorCount() const override {
+    return lastVisionFactors;
+  }
+  inline double GetLastOptimizeMs() const override { return lastOptimizeMs; }
+  inline size_t GetDroppedImuCount() const override { return droppedImu; }
+  inline const ReprojectionSummary &GetReprojectionSummary() const override {
+    return lastReprojection;
+  }
 
 protected:
   /**
@@ -88,7 +195,45 @@ protected:
   Key InsertIntoSmoother(Key lower, Key upper, Key newKey, double newTime,
                          gtsam::SharedNoiseModel odometryNoise);
 
-  Key GetOrInsertKey(Key newKey, double time);
+  Key GetOrInsertKey(Key newKey, double time) const;
+
+  // The state vision captured at timeUs should attach to, or 0 if it's too
+  // old for the smoother
+  Key FindStateFor(uint64_t timeUs) const;
+
+  // Best guess we have for a state, whether or not the smoother has it yet
+  gtsam::Pose3 StateGuess(Key key) const;
+
+  /**
+   * framePoseFactors version of AddTagObservations. Without a pool, cameras
+   * are done one after the other
+   */
+  void AddFrameFactors(
+      const std::vector<std::vector<CameraVisionObservation>> &perCamera,
+      WorkerPool *pool);
+
+  /**
+   * Integrate queued gyro readings up to timeUs, and constrain the rotation
+   * between lower and upper with the result
+   */
+  void AddGyroFactor(Key lower, Key upper, uint64_t timeUs);
+
+  // Count (and every so often log) a gyro reading we threw away
+  void DroppedImu(std::string_view why);
+
+  // A state as a world->robot expression, lifted to 3d if we're planar
+  gtsam::Pose3_ StateExpression(Key key) const;
+  // The smoother's estimate of a state, lifted to 3d if we're planar
+  gtsam::Pose3 CalculatePose(Key key) const;
+  // Initial guess for a new state. Returns what we actually inserted, lifted
+  // back to 3d
+  gtsam::Pose3 InsertEstimate(Key key, const gtsam::Pose3 &worldTbody);
+  // Odometry-style between factor, flattened if we're planar
+  void AddBetween(Key from, Key to, const gtsam::Pose3 &delta,
+                  const gtsam::SharedNoiseModel &noise);
+
+  // Remember an observation we built factors for, for diagnostics
+  void RecordForDiagnostics(const CameraVisionObservation &obs, Key state);
 
   // New factor graph to add to our smoother at the next call to Optimize()
   gtsam::ExpressionFactorGraph graph{};
@@ -102,13 +247,52 @@ protected:
   typedef std::map<Key, gtsam::Pose3> KeyPoseDeltaMap;
   KeyPoseDeltaMap twistsFromPreviousKey{};
 
-  // ISAM-backed fixed-lag smoother. Will marginalize out states older then a
-  // given lag.
-  gtsam::IncrementalFixedLagSmoother smootherISAM2;
+  // Gyro readings preintegrated since our latest state. Empty if no IMU
+  std::optional<gtsam::PreintegratedAhrsMeasurements> gyroPreintegrated;
+  // Readings we haven't integrated yet, at most imuQueueDepth
+  std::deque<ImuObservation> imuQueue;
+  size_t imuQueueDepth = 1000;
+  // Readings thrown away, because the queue was full or they were older than
+  // the interval we're integrating
+  size_t droppedImu = 0;
+  // Time we've integrated gyro readings up to
+  uint64_t imuIntegratedUntil = 0;
+  // Most recent reading, held over to the end of each state interval
+  gtsam::Vector3 lastGyro = gtsam::Vector3::Zero();
+  uint64_t lastGyroTime = 0;
+
+  // Vision factors queued up for the next Optimize(), and how many went into
+  // the last one
+  size_t pendingVisionFactors = 0;
+  size_t lastVisionFactors = 0;
+  double lastOptimizeMs = 0;
+
+  // Every vision observation still in the window, re-checked against the
+  // estimate after each Optimize()
+  ReprojectionDiagnostics diagnostics;
+  ReprojectionSummary lastReprojection;
+
+  // Field layout our tag observations are matched against. Until someone sends
+  // us one, assume this year's
+  TagModel tagModel{TagModel::DefaultLayout()};
+
+  // Set if our states are Pose2s on the floor
+  std::optional<PlanarLift> planar;
+  // If set, vision goes in as one pose factor per camera frame
+  bool framePoseFactors;
+  // If not, we never record observations for diagnostics
+  bool reprojectionDiagnostics;
+
+  // Flattened versions of every odometry noise model we've been handed
+  std::map<gtsam::SharedNoiseModel, gtsam::SharedNoiseModel> planarNoise;
+
+  // Fixed-lag smoother (ISAM2 or batch). Will marginalize out states older
+  // then a given lag.
+  std::unique_ptr<SmootherBackend> smoother;
 
   // Current "tip" world->body estimate
   gtsam::Pose3 wTb_latest;
-  uint64_t latestOdomTime;
+  uint64_t latestOdomTime = 0;
 
   // keep track of our current state. State is encoded as X(uS since epoch).
   // the Key class uses the lower 56 bits for the index, and top 8 for symbol
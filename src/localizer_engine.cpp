@@ -0,0 +1,55 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "localizer_engine.h"
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "ekf_localizer.h"
+#include "localizer.h"
+
+std::shared_ptr<LocalizerEngine>
+MakeLocalizerEngine(const LocalizerConfig &config, WorkerPool *pool) {
+  if (config.engine == "graph") {
+    if (config.visionFactors != "corners" && config.visionFactors != "frame") {
+      throw std::runtime_error(fmt::format("Unknown vision factor type: {}",
+                                           config.visionFactors));
+    }
+    return std::make_shared<Localizer>(LocalizerOptions{
+        .smoother = config.smoother,
+        .isam2 = config.isam2,
+        .planar = config.planar,
+        .framePoseFactors = config.visionFactors == "frame",
+        .reprojectionDiagnostics = config.reprojectionDiagnostics,
+        .pool = pool,
+    });
+  }
+  if (config.engine == "ekf") {
+    return std::make_shared<EkfLocalizer>();
+  }
+  throw std::runtime_error(
+      fmt::format("Unknown localizer engine: {}", config.engine));
+}
@@ -0,0 +1,122 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/NoiseModel.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <frc/apriltag/AprilTagFieldLayout.h>
+#include <frc/geometry/Pose3d.h>
+
+#include "config.h"
+#include "gtsam_utils.h"
+#include "reprojection_diagnostics.h"
+#include "worker_pool.h"
+
+/**
+ * Something that turns odometry and tag observations into a pose. The factor
+ * graph Localizer is the main one; EkfLocalizer is a much cheaper (and less
+ * accurate) stand-in for weak coprocessors. LocalizerRunner and DataPublisher
+ * only ever see this.
+ */
+class LocalizerEngine {
+public:
+  virtual ~LocalizerEngine() = default;
+
+  /**
+   * Start over from a world->robot pose
+   */
+  virtual void Reset(gtsam::Pose3 wTr, gtsam::SharedNoiseModel noise,
+                     uint64_t timeUs) = 0;
+
+  /**
+   * Swap out the field layout used for new tag observations
+   */
+  virtual void SetTagLayout(const frc::AprilTagFieldLayout &layout) = 0;
+
+  virtual void EnableImu(const ImuConfig &config) = 0;
+  virtual void AddImu(const ImuObservation &imu) = 0;
+
+  virtual void AddOdometry(const OdometryObservation &odom) = 0;
+
+  virtual void AddTagObservation(const CameraVisionObservation &obs) = 0;
+
+  /**
+   * Add every camera's observations for this cycle. Engines that can do some
+   * of the work in parallel get the pool to do it on; by default they're just
+   * added one at a time, in camera order.
+   */
+  virtual void AddTagObservations(
+      const std::vector<std::vector<CameraVisionObservation>> &perCamera,
+      WorkerPool &pool) {
+    for (const auto &camera : perCamera) {
+      for (const auto &obs : camera) {
+        AddTagObservation(obs);
+      }
+    }
+  }
+
+  /**
+   * Fold everything added since last time into our estimate
+   */
+  virtual void Optimize() = 0;
+
+  virtual void Print(const std::string_view prefix = "") = 0;
+
+  virtual gtsam::Key GetCurrStateIdx() const = 0;
+  virtual uint64_t GetLastOdomTime() const = 0;
+
+  virtual const gtsam::Pose3 GetLatestWorldToBody() const = 0;
+  // Covariance of the latest pose, in order [rx ry rz tx ty tz]
+  virtual gtsam::Matrix GetLatestMarginals() const = 0;
+
+  // Past poses (oldest first) and their capture times
+  virtual const std::vector<Timestamped<frc::Pose3d>>
+  GetPoseHistory() const = 0;
+
+  // Vision factors (or updates) that went into the last Optimize()
+  virtual size_t GetLastVisionFactorCount() const = 0;
+  // Wall time the last Optimize() took
+  virtual double GetLastOptimizeMs() const = 0;
+  // Gyro readings thrown away so far
+  virtual size_t GetDroppedImuCount() const = 0;
+
+  // How well vision fit the estimate as of the last Optimize(). Empty if the
+  // engine doesn't keep track
+  virtual const ReprojectionSummary &GetReprojectionSummary() const = 0;
+};
+
+/**
+ * Make the engine a robot's config asks for: "graph" (the default, using
+ * config.smoother) or "ekf". Throws if we don't know the name.
+ *
+ * @param pool for any background work the engine does. Must outlive it
+ */
+std::shared_ptr<LocalizerEngine>
+MakeLocalizerEngine(const LocalizerConfig &config, WorkerPool *pool = nullptr);
@@ -0,0 +1,270 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "localizer_runner.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "pnp.h"
+
+using namespace std::chrono_literals;
+
+LocalizerRunner::LocalizerRunner(LocalizerConfig config, WorkerPool &pool)
+    : config(config), pool(pool), localizer(MakeLocalizerEngine(config, &pool)),
+      odomListener{config}, dataPublisher(config, localizer),
+      configListener(config), latency(config.cameras.size()),
+      loadShedder(config.loadShedding) {
+  cameraListeners.reserve(config.cameras.size());
+  for (const CameraConfig &camCfg : config.cameras) {
+    cameraListeners.emplace_back(config.rootTableName, camCfg);
+  }
+  visionBuffers.resize(cameraListeners.size());
+  afterReset.resize(cameraListeners.size());
+
+  if (config.imu) {
+    localizer->EnableImu(*config.imu);
+    imuListener.emplace(config);
+  }
+}
+
+void LocalizerRunner::Update() {
+  const auto now = std::chrono::steady_clock::now();
+  if (now < nextReadyCheck) {
+    return;
+  }
+
+  bool readyToOptimize = true;
+
+  if (const auto prior = configListener.NewPosePrior()) {
+    localizer->Reset(prior->value.pose, prior->value.noise, prior->time);
+    DropHeldThrough(prior->time);
+    gotInitialGuess = true;
+  }
+
+  if (const auto layout = configListener.NewTagLayout()) {
+    localizer->SetTagLayout(*layout);
+    tagModel.SetLayout(*layout);
+
+    // Reset initial guess tracking since we got a new layout and our factors
+    // are technically now wrong
+    gotInitialGuess = false;
+  }
+
+  const auto windowUs = static_cast<uint64_t>(config.reorderWindowMs * 1000);
+  const bool holdOdometry = windowUs > 0 && config.reorderOdometry;
+
+  // IMU readings need to be queued before the odometry that closes their
+  // interval shows up
+  if (imuListener) {
+    for (const auto &it : imuListener->Update()) {
+      localizer->AddImu(it);
+    }
+  }
+
+  std::vector<OdometryObservation> odometry;
+  for (auto &it : odomListener.Update()) {
+    newestOdomUs = std::max(newestOdomUs, it.timeUs);
+
+    if (holdOdometry) {
+      odomBuffer.Push(std::move(it));
+    } else {
+      odometry.push_back(std::move(it));
+    }
+  }
+
+  // Odometry is our clock -- anything captured more than a window before the
+  // newest odometry we've heard about is considered settled
+  const uint64_t cutoffUs =
+      newestOdomUs > windowUs ? newestOdomUs - windowUs : 0;
+  if (holdOdometry) {
+    odometry = odomBuffer.Release(cutoffUs);
+  }
+
+  // A PnP reset below would throw away anything added before it, so while
+  // one might happen this cycle's odometry waits until after
+  const bool initializing = !gotInitialGuess && config.autoInitialize;
+  uint64_t lastStateUs = localizer->GetLastOdomTime();
+  if (!initializing) {
+    AddOdometry(odometry);
+  } else if (!odometry.empty()) {
+    lastStateUs = std::max(lastStateUs, odometry.back().timeUs);
+  }
+  // and vision can't be attached past the newest state actually added
+  const uint64_t visionCutoffUs = std::min(cutoffUs, lastStateUs);
+
+  // localizer->Print("=========================\nAfter adding odometry
+  // factors");
+
+  // Each camera reads and decodes its queue on its own thread. The engine
+  // then gets them all at once, in camera order
+  std::vector<std::vector<CameraVisionObservation>> perCamera(
+      cameraListeners.size());
+  // not vector<bool>, we write these from several threads
+  std::vector<char> camerasReady(cameraListeners.size());
+
+  pool.ParallelFor(cameraListeners.size(), [&](size_t i) {
+    CameraListener &cam = cameraListeners[i];
+
+    camerasReady[i] = cam.ReadyToOptimize();
+    if (!camerasReady[i]) {
+      return;
+    }
+
+    auto observations = cam.Update();
+    if (!afterReset[i].empty()) {
+      observations.insert(observations.begin(),
+                          std::make_move_iterator(afterReset[i].begin()),
+                          std::make_move_iterator(afterReset[i].end()));
+      afterReset[i].clear();
+    }
+    if (windowUs > 0) {
+      for (auto &it : observations) {
+        visionBuffers[i].Push(std::move(it));
+      }
+      observations = visionBuffers[i].Release(visionCutoffUs);
+    }
+    for (auto &obs : observations) {
+      obs.cameraIndex = static_cast<uint32_t>(i);
+    }
+
+    perCamera[i] = std::move(observations);
+  });
+
+  for (size_t i = 0; i < cameraListeners.size(); i++) {
+    readyToOptimize &= static_cast<bool>(camerasReady[i]);
+  }
+
+  // No guess from robot code yet, so try to find ourselves
+  if (!gotInitialGuess && config.autoInitialize) {
+    if (const auto solve = pnp::SolveBestFrame(perCamera, tagModel)) {
+      fmt::println("{}: Initialized from PnP at t={}", config.rootTableName,
+                   solve->time);
+      localizer->Reset(solve->value.pose, solve->value.noise, solve->time);
+      DropHeldThrough(solve->time);
+      gotInitialGuess = true;
+
+      // The solved frame is in the prior already, and anything older has
+      // nothing to attach to. Newer frames wait for the odometry after it
+      for (size_t i = 0; i < perCamera.size(); i++) {
+        for (auto &obs : perCamera[i]) {
+          if (obs.timeUs > solve->time) {
+            afterReset[i].push_back(std::move(obs));
+          }
+        }
+        perCamera[i].clear();
+      }
+
+      // Same for odometry: the prior already covers the motion up to it
+      std::erase_if(odometry, [&](const OdometryObservation &it) {
+        return it.timeUs <= solve->time;
+      });
+    }
+  }
+  if (initializing) {
+    AddOdometry(odometry);
+  }
+  readyToOptimize &= gotInitialGuess;
+
+  // Scoring needs an estimate to score against, so until then it all goes in
+  if (gotInitialGuess) {
+    const SheddingStats stats =
+        loadShedder.Apply(perCamera, tagModel, *localizer);
+    shedding.kept += stats.kept;
+    shedding.dropped += stats.dropped;
+  } else {
+    for (const auto &camera : perCamera) {
+      shedding.kept += camera.size();
+    }
+  }
+
+  localizer->AddTagObservations(perCamera, pool);
+  latency.AddVision(perCamera);
+
+  if (!readyToOptimize) {
+    fmt::println("{}: Not yet ready (see above) -- busywaiting",
+                 config.rootTableName);
+    nextReadyCheck = now + 1000ms;
+    return;
+  }
+
+  // localizer->Print("=========================\nAfter adding vision
+  // factors");
+
+  try {
+    localizer->Optimize();
+
+    CollectQueueStats();
+    dataPublisher.Update(latency, shedding, queueStats);
+    shedding = {};
+  } catch (const std::exception &e) {
+    fmt::println("{}: Exception optimizing: {}", config.rootTableName,
+                 e.what());
+    localizer->Print();
+    throw;
+  }
+}
+
+void LocalizerRunner::AddOdometry(
+    const std::vector<OdometryObservation> &odometry) {
+  for (const auto &it : odometry) {
+    // A between factor back to an older state would fork the chain, so
+    // unlike vision, stragglers are dropped rather than added late
+    if (it.timeUs <= localizer->GetLastOdomTime()) {
+      odomStragglers++;
+      continue;
+    }
+    localizer->AddOdometry(it);
+    latency.AddOdometry(it);
+  }
+}
+
+void LocalizerRunner::DropHeldThrough(uint64_t timeUs) {
+  odomBuffer.DropThrough(timeUs);
+  for (auto &buffer : visionBuffers) {
+    buffer.DropThrough(timeUs);
+  }
+  for (auto &held : afterReset) {
+    std::erase_if(held, [timeUs](const CameraVisionObservation &obs) {
+      return obs.timeUs <= timeUs;
+    });
+  }
+}
+
+void LocalizerRunner::CollectQueueStats() {
+  queueStats.odomDropped = odomListener.Dropped();
+  queueStats.odomCoalesced = odomListener.Coalesced();
+  queueStats.odomStragglers = odomStragglers;
+
+  queueStats.cameraDroppedFrames.clear();
+  queueStats.cameraStragglers.clear();
+  for (size_t i = 0; i < cameraListeners.size(); i++) {
+    queueStats.cameraDroppedFrames.push_back(
+        cameraListeners[i].DroppedFrames());
+    queueStats.cameraStragglers.push_back(
+        static_cast<int64_t>(visionBuffers[i].Stragglers()));
+  }
+}
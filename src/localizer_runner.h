@@ -0,0 +1,122 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "TagModel.h"
+#include "camera_listener.h"
+#include "config.h"
+#include "config_listener.h"
+#include "data_publisher.h"
+#include "imu_listener.h"
+#include "input_queue.h"
+#include "latency_tracker.h"
+#include "load_shedder.h"
+#include "localizer_engine.h"
+#include "odom_listener.h"
+#include "reorder_buffer.h"
+#include "worker_pool.h"
+
+/**
+ * Glue between one robot's NT topics and its LocalizerEngine. Each robot in the
+ * node config gets its own runner.
+ */
+class LocalizerRunner {
+public:
+  /**
+   * @param pool worker pool shared with any other runners. Must outlive us
+   */
+  LocalizerRunner(LocalizerConfig config, WorkerPool &pool);
+
+  /**
+   * Pull new data from NT, optimize and publish. Does not flush NT, so that
+   * several runners can share one flush.
+   */
+  void Update();
+
+  inline const LocalizerConfig &GetConfig() const { return config; }
+
+private:
+  /**
+   * Hand odometry (oldest first) to the localizer and latency tracker,
+   * dropping any that's no newer than the localizer's newest state
+   */
+  void AddOdometry(const std::vector<OdometryObservation> &odometry);
+
+  /**
+   * Throw away held observations a reset at timeUs made stale
+   */
+  void DropHeldThrough(uint64_t timeUs);
+
+  /**
+   * Fill queueStats from the listeners and reorder buffers
+   */
+  void CollectQueueStats();
+
+  LocalizerConfig config;
+  WorkerPool &pool;
+
+  std::shared_ptr<LocalizerEngine> localizer;
+  OdomListener odomListener;
+  DataPublisher dataPublisher;
+  ConfigListener configListener;
+  std::vector<CameraListener> cameraListeners;
+  // Only if config.imu is set
+  std::optional<ImuListener> imuListener;
+  // Capture -> publish times for everything we feed the engine
+  LatencyTracker latency;
+
+  LoadShedder loadShedder;
+  // What it did with the vision going into the next publish, summed over
+  // every cycle since the last one
+  SheddingStats shedding;
+  // Scratch for collecting the listeners' overflow and straggler counts
+  InputQueueStats queueStats;
+
+  // Late-arrival buffers, only used if config.reorderWindowMs > 0. One per
+  // camera, so each camera's thread owns its own
+  std::vector<ReorderBuffer<CameraVisionObservation>> visionBuffers;
+  ReorderBuffer<OdometryObservation> odomBuffer;
+  // Vision captured after a PnP reset, with no state to hang off yet. Goes in
+  // ahead of each camera's next read
+  std::vector<std::vector<CameraVisionObservation>> afterReset;
+  // Odometry dropped for showing up after newer odometry was already added
+  int64_t odomStragglers = 0;
+  // Capture time of the newest odometry we've received (not necessarily
+  // added yet)
+  uint64_t newestOdomUs = 0;
+
+  bool gotInitialGuess = false;
+  // Our own copy of the layout, for PnP initialization
+  TagModel tagModel{TagModel::DefaultLayout()};
+
+  // While we're not ready, only re-check this often so we don't spam the
+  // console (or hog the shared worker pool)
+  std::chrono::steady_clock::time_point nextReadyCheck{};
+};
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "model_registry.h"
+
+using namespace gtsam;
+
+ModelRegistry &ModelRegistry::GetDefault() {
+  static ModelRegistry instance;
+  return instance;
+}
+
+const SharedNoiseModel &ModelRegistry::InternNoise(const Vector &sigmas) {
+  std::vector<double> key(sigmas.data(), sigmas.data() + sigmas.size());
+
+  std::lock_guard lock(mutex);
+  auto it = noiseModels.find(key);
+  if (it == noiseModels.end()) {
+    it = noiseModels
+             .emplace(std::move(key), noiseModel::Diagonal::Sigmas(sigmas))
+             .first;
+  }
+  return it->second;
+}
+
+const SharedNoiseModel &ModelRegistry::InternCovariance(const Matrix &cov) {
+  std::vector<double> key(cov.data(), cov.data() + cov.size());
+
+  std::lock_guard lock(mutex);
+  auto it = covarianceModels.find(key);
+  if (it == covarianceModels.end()) {
+    it = covarianceModels
+             .emplace(std::move(key), noiseModel::Gaussian::Covariance(cov))
+             .first;
+  }
+  return it->second;
+}
+
+size_t ModelRegistry::NumNoiseModels() const {
+  std::lock_guard lock(mutex);
+  return noiseModels.size() + covarianceModels.size();
+}
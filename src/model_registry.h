@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/linear/NoiseModel.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * Interns noise models by value. Every observation (and so every factor) from
+ * the same camera or odometry source ends up pointing at one shared object,
+ * instead of each carrying its own refcounted copy. References handed out
+ * stay valid for the lifetime of the registry, so listeners can cache them and
+ * compare addresses to detect changes.
+ */
+class ModelRegistry {
+public:
+  ModelRegistry() = default;
+  ModelRegistry(const ModelRegistry &) = delete;
+  ModelRegistry &operator=(const ModelRegistry &) = delete;
+
+  /**
+   * Process-wide registry shared by all listeners
+   */
+  static ModelRegistry &GetDefault();
+
+  /**
+   * Find or create a diagonal noise model with these standard deviations.
+   * All-equal sigmas collapse to an isotropic model.
+   */
+  const gtsam::SharedNoiseModel &InternNoise(const gtsam::Vector &sigmas);
+
+  /**
+   * Find or create a Gaussian noise model with this covariance. A diagonal
+   * one collapses to a diagonal model.
+   */
+  const gtsam::SharedNoiseModel &InternCovariance(const gtsam::Matrix &cov);
+
+  size_t NumNoiseModels() const;
+
+private:
+  mutable std::mutex mutex;
+
+  // std::map nodes never move, so references into these are stable
+  std::map<std::vector<double>, gtsam::SharedNoiseModel> noiseModels;
+  // Keyed on the covariance's entries, column-major
+  std::map<std::vector<double>, gtsam::SharedNoiseModel> covarianceModels;
+};
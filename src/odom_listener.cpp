@@ -24,13 +24,28 @@
 
 #include "odom_listener.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 #include <networktables/NetworkTableInstance.h>
 
 #include "gtsam_utils.h"
+#include "input_queue.h"
+#include "model_registry.h"
 
 using std::vector;
 using namespace gtsam;
 
+static bool shouldCoalesce(const std::string &overflow) {
+  if (overflow == "coalesce") {
+    return true;
+  }
+  if (overflow == "drop") {
+    return false;
+  }
+  throw std::runtime_error("Unknown odomOverflow " + overflow);
+}
+
 static Vector6 makeOdomNoise(const LocalizerConfig &config) {
   return Vector6{config.rotNoise[0],   config.rotNoise[1],
                  config.rotNoise[2],   config.transNoise[0],
@@ -43,19 +58,23 @@ OdomListener::OdomListener(LocalizerConfig config)
                                                 "/input/odom_twist")
                   .Subscribe({},
                              {
-                                 .pollStorage = 100,
+                                 .pollStorage =
+                                     PollStorageFor(config.odomQueueDepth),
                                  .sendAll = true,
                                  .keepDuplicates = true,
                              })),
-      odomNoise(noiseModel::Diagonal::Sigmas(
+      queueDepth(std::max(0, config.odomQueueDepth)),
+      coalesce(shouldCoalesce(config.odomOverflow)),
+      odomNoise(&ModelRegistry::GetDefault().InternNoise(
           // Odoometry factor stdev: rad,rad,rad,m, m, m
           makeOdomNoise(config))),
-      priorNoise(noiseModel::Diagonal::Sigmas(
+      priorNoise(&ModelRegistry::GetDefault().InternNoise(
           // initial guess stdev: rad,rad,rad,m, m, m
           (Vector(6) << 1, 1, 1, 1, 1, 1).finished())) {}
 
 std::vector<OdometryObservation> OdomListener::Update() {
   const auto odom = odomSub.ReadQueue();
+  const auto readUs = static_cast<uint64_t>(nt::Now());
 
   std::vector<OdometryObservation> ret;
   ret.reserve(odom.size());
@@ -69,7 +88,13 @@ std::vector<OdometryObservation> OdomListener::Update() {
         twist.dz.to<double>();
     Pose3 odomPoseDelta = Pose3::Expmap(eigenTwist);
 
-    ret.emplace_back(o.time, odomPoseDelta, odomNoise);
+    ret.emplace_back(o.time, odomPoseDelta, odomNoise, readUs);
+  }
+
+  if (coalesce) {
+    coalesced += CoalesceOdometry(ret, queueDepth, ModelRegistry::GetDefault());
+  } else {
+    dropped += DropOldest(ret, queueDepth);
   }
 
   return ret;
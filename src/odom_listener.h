@@ -26,6 +26,7 @@
 
 #include <gtsam/linear/NoiseModel.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -45,11 +46,24 @@ public:
 
   std::vector<OdometryObservation> Update();
 
+  /**
+   * Deltas thrown away, or merged into others, because more than
+   * odomQueueDepth arrived in one cycle. Cumulative
+   */
+  int64_t Dropped() const { return dropped; }
+  int64_t Coalesced() const { return coalesced; }
+
 private:
   nt::StructSubscriber<frc::Twist3d> odomSub;
 
-  ::gtsam::SharedNoiseModel odomNoise;
-  ::gtsam::SharedNoiseModel priorNoise;
+  size_t queueDepth;
+  bool coalesce;
+  int64_t dropped = 0;
+  int64_t coalesced = 0;
+
+  // Interned in the default ModelRegistry
+  const ::gtsam::SharedNoiseModel *odomNoise;
+  const ::gtsam::SharedNoiseModel *priorNoise;
 
   std::optional<Timestamped<Pose3WithNoise>> newPriorPose;
 };
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "planar.h"
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+
+using namespace gtsam;
+
+PlanarLift::PlanarLift(const PlanarConfig &config)
+    : height(config.height),
+      floorRrobot(Rot3::RzRyRx(config.roll, config.pitch, 0)),
+      liftJacobian(Matrix63::Zero()) {
+  // Yaw spins about the floor normal, which the robot sees as R0^T z. Floor
+  // x/y moves show up in the robot frame the same way
+  const Matrix3 robotRfloor = floorRrobot.matrix().transpose();
+  liftJacobian.block<3, 1>(0, 2) = robotRfloor.col(2);
+  liftJacobian.block<3, 2>(3, 0) = robotRfloor.leftCols<2>();
+}
+
+Pose3 PlanarLift::Lift(const Pose2 &pose, OptionalJacobian<6, 3> H) const {
+  if (H) {
+    *H = liftJacobian;
+  }
+  return Pose3{Rot3::Yaw(pose.theta()) * floorRrobot,
+               Point3{pose.x(), pose.y(), height}};
+}
+
+Pose3_ PlanarLift::Lift(const Pose2_ &pose) const {
+  return Pose3_(
+      [lift = *this](const Pose2 &p, OptionalJacobian<6, 3> H) {
+        return lift.Lift(p, H);
+      },
+      pose);
+}
+
+Matrix6 PlanarLift::LiftCovariance(const Matrix3 &covariance) const {
+  return liftJacobian * covariance * liftJacobian.transpose();
+}
+
+Pose2 PlanarLift::Flatten(const Pose3 &pose) {
+  return Pose2{pose.x(), pose.y(), pose.rotation().yaw()};
+}
+
+SharedNoiseModel PlanarLift::FlattenNoise(const SharedNoiseModel &noise) {
+  // Pose2 [x y theta] out of Pose3 [rx ry rz tx ty tz]
+  constexpr std::array<int, 3> kIndices{3, 4, 2};
+
+  if (const auto diagonal =
+          std::dynamic_pointer_cast<noiseModel::Diagonal>(noise)) {
+    const Vector sigmas = diagonal->sigmas();
+    return noiseModel::Diagonal::Sigmas(
+        Vector3{sigmas(kIndices[0]), sigmas(kIndices[1]), sigmas(kIndices[2])});
+  }
+
+  const auto gaussian = std::dynamic_pointer_cast<noiseModel::Gaussian>(noise);
+  if (!gaussian) {
+    throw std::runtime_error("Can only flatten Gaussian noise models");
+  }
+  const Matrix covariance = gaussian->covariance();
+  Matrix3 flat;
+  for (int row = 0; row < 3; row++) {
+    for (int col = 0; col < 3; col++) {
+      flat(row, col) = covariance(kIndices[row], kIndices[col]);
+    }
+  }
+  return noiseModel::Gaussian::Covariance(flat);
+}
@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Pose2.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/NoiseModel.h>
+#include <gtsam/slam/expressions.h>
+
+#include "config.h"
+
+/**
+ * How a planar (x, y, yaw) state sits in 3d: at a fixed height above the
+ * floor, with a fixed roll and pitch. Lets a planar localizer keep Pose2
+ * states but still project tag corners through full 3d camera poses.
+ */
+class PlanarLift {
+public:
+  explicit PlanarLift(const PlanarConfig &config);
+
+  /**
+   * world->robot Pose3 for a floor pose
+   *
+   * @param H derivative wrt the Pose2, in Pose3's [rx ry rz tx ty tz]
+   */
+  gtsam::Pose3 Lift(const gtsam::Pose2 &pose,
+                    gtsam::OptionalJacobian<6, 3> H = {}) const;
+  gtsam::Pose3_ Lift(const gtsam::Pose2_ &pose) const;
+
+  /**
+   * Pose3 covariance of a lifted pose, from its Pose2 covariance. Height,
+   * roll and pitch are fixed, so that's all zero outside the yaw/xy blocks.
+   */
+  gtsam::Matrix6 LiftCovariance(const gtsam::Matrix3 &covariance) const;
+
+  /**
+   * Drop height, roll and pitch
+   */
+  static gtsam::Pose2 Flatten(const gtsam::Pose3 &pose);
+
+  /**
+   * The [x y yaw] part of a Pose3 noise model
+   */
+  static gtsam::SharedNoiseModel
+  FlattenNoise(const gtsam::SharedNoiseModel &noise);
+
+private:
+  double height;
+  // Robot frame relative to a yaw-only frame on the floor
+  gtsam::Rot3 floorRrobot;
+  // d(Lift)/d(pose). Doesn't depend on the pose
+  gtsam::Matrix63 liftJacobian;
+};
@@ -0,0 +1,315 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pnp.h"
+
+#include <gtsam/geometry/CalibratedCamera.h>
+#include <gtsam/nonlinear/ExpressionFactorGraph.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include <gtsam/nonlinear/Marginals.h>
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <map>
+
+#include <Eigen/Cholesky>
+#include <Eigen/SVD>
+
+using namespace gtsam;
+using std::vector;
+
+namespace {
+
+// Sum of squared whitened corner errors for a world->robot guess. Infinite if
+// any corner ends up behind its camera
+double FrameError(const Pose3 &worldTrobot,
+                  const vector<CameraVisionObservation> &frame,
+                  const TagModel &tagModel) {
+  double error = 0;
+  for (const auto &obs : frame) {
+    const auto worldPcorners = tagModel.WorldToCorners(obs.tagID);
+    if (!worldPcorners) {
+      continue;
+    }
+    const Pose3 worldTcamera = worldTrobot * obs.robotTcamera;
+    for (size_t i = 0; i < worldPcorners->size() && i < obs.corners.size();
+         i++) {
+      const Point3 cameraP = worldTcamera.transformTo((*worldPcorners)[i]);
+      if (cameraP.z() <= 1e-6) {
+        return std::numeric_limits<double>::infinity();
+      }
+      const Vector2 residual{cameraP.x() / cameraP.z() - obs.corners[i].x(),
+                             cameraP.y() / cameraP.z() - obs.corners[i].y()};
+      error += (*obs.cameraNoise)->whiten(residual).squaredNorm();
+    }
+  }
+  return error;
+}
+
+} // namespace
+
+namespace pnp {
+
+std::optional<Pose3>
+CameraToTagFromHomography(const vector<Point2> &corners) {
+  const auto &tagPcorners = TagModel::TagToCorners();
+  if (corners.size() != tagPcorners.size()) {
+    return std::nullopt;
+  }
+
+  // Tag corners only span a few cm, scale them up to ~1 so the DLT is
+  // conditioned about as well as the image side
+  const double scale = std::abs(tagPcorners[0].y());
+
+  // DLT: each corner gives two rows of A h = 0, tag plane (y, z) -> image
+  Eigen::Matrix<double, 8, 9> A;
+  for (size_t i = 0; i < 4; i++) {
+    const double u = tagPcorners[i].y() / scale;
+    const double v = tagPcorners[i].z() / scale;
+    const double x = corners[i].x();
+    const double y = corners[i].y();
+    A.row(2 * i) << -u, -v, -1, 0, 0, 0, x * u, x * v, x;
+    A.row(2 * i + 1) << 0, 0, 0, -u, -v, -1, y * u, y * v, y;
+  }
+  const Eigen::JacobiSVD<Eigen::Matrix<double, 8, 9>> svd(A,
+                                                          Eigen::ComputeFullV);
+  const Eigen::Matrix<double, 9, 1> h = svd.matrixV().col(8);
+  Matrix3 H;
+  H << h(0), h(1), h(2), h(3), h(4), h(5), h(6), h(7), h(8);
+  // Undo the scaling
+  H.leftCols<2>() /= scale;
+
+  // H ~ [r2 r3 t], since the tag lies in its own y-z plane
+  const double norm = H.col(0).norm() + H.col(1).norm();
+  if (norm < 1e-12) {
+    return std::nullopt;
+  }
+  double lambda = 2 / norm;
+  // Tag has to be in front of the camera
+  if (H(2, 2) < 0) {
+    lambda = -lambda;
+  }
+  const Vector3 r2 = lambda * H.col(0);
+  const Vector3 r3 = lambda * H.col(1);
+  Matrix3 R;
+  R << r2.cross(r3), r2, r3;
+
+  return Pose3{Rot3::ClosestTo(R), Point3{lambda * H.col(2)}};
+}
+
+Pose3 FlipAmbiguity(const Pose3 &cameraTtag) {
+  const Vector3 normal = cameraTtag.rotation().matrix().col(0);
+  const Vector3 ray = cameraTtag.translation().normalized();
+  const Vector3 mirrored = 2 * normal.dot(ray) * ray - normal;
+
+  const Vector3 axis = normal.cross(mirrored);
+  if (axis.norm() < 1e-9) {
+    // Looking straight at it, there's nothing to flip
+    return cameraTtag;
+  }
+  const double angle =
+      std::atan2(axis.norm(), std::clamp(normal.dot(mirrored), -1.0, 1.0));
+  const Rot3 flip = Rot3::AxisAngle(axis.normalized(), angle);
+  return Pose3{flip * cameraTtag.rotation(), cameraTtag.translation()};
+}
+
+std::optional<Timestamped<Pose3WithNoise>>
+SolveFrame(const vector<CameraVisionObservation> &frame,
+           const TagModel &tagModel) {
+  // Every tag gives two starting guesses, keep whichever explains the whole
+  // frame best
+  std::optional<Pose3> bestGuess;
+  double bestError = std::numeric_limits<double>::infinity();
+  size_t corners = 0;
+
+  for (const auto &obs : frame) {
+    const auto worldTtag = tagModel.WorldToTag(obs.tagID);
+    if (!worldTtag) {
+      continue;
+    }
+    corners += obs.corners.size();
+
+    const auto cameraTtag = CameraToTagFromHomography(obs.corners);
+    if (!cameraTtag) {
+      continue;
+    }
+    for (const Pose3 &candidate : {*cameraTtag, FlipAmbiguity(*cameraTtag)}) {
+      const Pose3 worldTrobot =
+          *worldTtag * candidate.inverse() * obs.robotTcamera.inverse();
+      const double error = FrameError(worldTrobot, frame, tagModel);
+      if (error < bestError) {
+        bestError = error;
+        bestGuess = worldTrobot;
+      }
+    }
+  }
+
+  if (!bestGuess) {
+    return std::nullopt;
+  }
+
+  // Refine over every corner we have
+  const Key key = 0;
+  ExpressionFactorGraph graph;
+  for (const auto &obs : frame) {
+    const auto worldPcorners = tagModel.WorldToCorners(obs.tagID);
+    if (!worldPcorners) {
+      continue;
+    }
+    for (size_t i = 0; i < worldPcorners->size() && i < obs.corners.size();
+         i++) {
+      graph.addExpressionFactor(
+          PredictLandmarkImageLocation(Pose3_(key), obs.robotTcamera,
+                                       (*worldPcorners)[i]),
+          obs.corners[i], *obs.cameraNoise);
+    }
+  }
+
+  Values initial;
+  initial.insert(key, *bestGuess);
+
+  try {
+    const Values result =
+        LevenbergMarquardtOptimizer(graph, initial).optimize();
+    const Pose3 worldTrobot = result.at<Pose3>(key);
+
+    const double rms = std::sqrt(2 * graph.error(result) / corners);
+    if (!std::isfinite(rms) || rms > kMaxRms) {
+      return std::nullopt;
+    }
+
+    const Matrix6 covariance =
+        kCovarianceInflation * Marginals(graph, result).marginalCovariance(key);
+
+    return Timestamped<Pose3WithNoise>{
+        frame.front().timeUs,
+        {worldTrobot, noiseModel::Gaussian::Covariance(covariance)}};
+  } catch (const std::exception &) {
+    // Cheirality or an indeterminate system, either way we can't use it
+    return std::nullopt;
+  }
+}
+
+std::optional<Pose3WithNoise>
+RefineCameraPose(const vector<CameraVisionObservation> &frame,
+                 const TagModel &tagModel, const Pose3 &worldTcameraGuess) {
+  constexpr int kMaxIterations = 10;
+
+  Pose3 worldTcamera = worldTcameraGuess;
+  Matrix6 information;
+  double error = 0;
+  size_t corners = 0;
+
+  for (int iteration = 0; iteration < kMaxIterations; iteration++) {
+    // Normal equations of the whitened corner residuals
+    information.setZero();
+    Vector6 gradient = Vector6::Zero();
+    error = 0;
+    corners = 0;
+
+    for (const auto &obs : frame) {
+      const auto worldPcorners = tagModel.WorldToCorners(obs.tagID);
+      if (!worldPcorners) {
+        continue;
+      }
+      const SharedNoiseModel &noise = *obs.cameraNoise;
+
+      for (size_t i = 0; i < worldPcorners->size() && i < obs.corners.size();
+           i++) {
+        Matrix36 Dpose;
+        const Point3 cameraP =
+            worldTcamera.transformTo((*worldPcorners)[i], Dpose);
+        if (cameraP.z() <= 1e-6) {
+          return std::nullopt;
+        }
+        Matrix23 Dpoint;
+        const Point2 predicted = PinholeBase::Project(cameraP, Dpoint);
+
+        const Vector residual = noise->whiten(predicted - obs.corners[i]);
+        const Matrix26 J = noise->Whiten(Dpoint * Dpose);
+
+        information += J.transpose() * J;
+        gradient += J.transpose() * residual;
+        error += residual.squaredNorm();
+        corners++;
+      }
+    }
+
+    if (corners == 0) {
+      return std::nullopt;
+    }
+
+    const Eigen::LLT<Matrix6> llt(information);
+    if (llt.info() != Eigen::Success) {
+      return std::nullopt;
+    }
+    const Vector6 step = -llt.solve(gradient);
+    worldTcamera = worldTcamera.retract(step);
+    if (step.norm() < 1e-8) {
+      break;
+    }
+  }
+
+  if (std::sqrt(error / corners) > kMaxRms) {
+    return std::nullopt;
+  }
+
+  const Matrix6 covariance = information.inverse();
+  return Pose3WithNoise{worldTcamera,
+                        noiseModel::Gaussian::Covariance(covariance)};
+}
+
+std::optional<Timestamped<Pose3WithNoise>>
+SolveBestFrame(const vector<vector<CameraVisionObservation>> &perCamera,
+               const TagModel &tagModel) {
+  vector<vector<CameraVisionObservation>> frames;
+  for (const auto &camera : perCamera) {
+    std::map<uint64_t, vector<CameraVisionObservation>> byTime;
+    for (const auto &obs : camera) {
+      byTime[obs.timeUs].push_back(obs);
+    }
+    for (auto &[time, frame] : byTime) {
+      frames.push_back(std::move(frame));
+    }
+  }
+
+  // Most tags first, newest first among those
+  std::sort(frames.begin(), frames.end(), [](const auto &a, const auto &b) {
+    if (a.size() != b.size()) {
+      return a.size() > b.size();
+    }
+    return a.front().timeUs > b.front().timeUs;
+  });
+
+  for (const auto &frame : frames) {
+    if (auto solve = SolveFrame(frame, tagModel)) {
+      return solve;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace pnp
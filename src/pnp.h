@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Point2.h>
+#include <gtsam/geometry/Pose3.h>
+
+#include <optional>
+#include <vector>
+
+#include "TagModel.h"
+#include "gtsam_utils.h"
+
+/**
+ * Single-frame pose solves, used to start a localizer without waiting for a
+ * pose_initial_guess from robot code.
+ */
+namespace pnp {
+
+// Reject solves whose RMS whitened corner error is worse than this
+constexpr double kMaxRms = 3;
+// One frame's covariance is optimistic (corner bias, the planar flip
+// ambiguity), so scale it up before seeding the smoother with it
+constexpr double kCovarianceInflation = 4;
+
+/**
+ * camera->tag pose from one tag's corners (normalized image coordinates, in
+ * TagModel::TagToCorners order), by decomposing the tag plane's homography.
+ * Only good enough to start an optimizer from.
+ */
+std::optional<gtsam::Pose3>
+CameraToTagFromHomography(const std::vector<gtsam::Point2> &corners);
+
+/**
+ * The other camera->tag pose a planar target can't tell apart from cameraTtag
+ * at a distance: the tag's normal mirrored about the ray to its center.
+ */
+gtsam::Pose3 FlipAmbiguity(const gtsam::Pose3 &cameraTtag);
+
+/**
+ * world->robot pose from every tag seen in one frame. Every observation has
+ * to share a capture time (they can come from different cameras). Each tag's
+ * homography gives candidate starting poses, the best one is refined over all
+ * corners with Levenberg-Marquardt, and the noise comes from the marginal
+ * covariance of that solve.
+ *
+ * @return nothing if no tag is in the layout, or the fit is too poor to trust
+ */
+std::optional<Timestamped<Pose3WithNoise>>
+SolveFrame(const std::vector<CameraVisionObservation> &frame,
+           const TagModel &tagModel);
+
+/**
+ * Polish a camera's world pose against every corner it saw in one frame,
+ * with a few Gauss-Newton steps from a guess (eg the smoother's estimate).
+ * Every observation has to come from the same camera and capture time.
+ *
+ * @return world->camera and its covariance from the solve's Jacobian, or
+ * nothing if it didn't fit
+ */
+std::optional<Pose3WithNoise>
+RefineCameraPose(const std::vector<CameraVisionObservation> &frame,
+                 const TagModel &tagModel, const gtsam::Pose3 &worldTcamera);
+
+/**
+ * Split a cycle's observations into frames (one camera, one capture time)
+ * and solve the ones with the most tags first, until one works
+ */
+std::optional<Timestamped<Pose3WithNoise>> SolveBestFrame(
+    const std::vector<std::vector<CameraVisionObservation>> &perCamera,
+    const TagModel &tagModel);
+
+} // namespace pnp
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "realtime.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+bool ConfigureCurrentThread(const std::vector<int> &cpus,
+                            const RealtimeConfig &config) {
+  bool ok = true;
+
+  if (!cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+      if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        fmt::println("Ignoring cpu {}, out of range", cpu);
+        ok = false;
+        continue;
+      }
+      CPU_SET(cpu, &set);
+    }
+    if (int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+      fmt::println("Couldn't pin thread to cpus [{}]: {}", fmt::join(cpus, ","),
+                   std::strerror(err));
+      ok = false;
+    }
+  }
+
+  if (config.fifoPriority > 0) {
+    sched_param param{};
+    param.sched_priority = config.fifoPriority;
+    if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+      fmt::println("Couldn't set SCHED_FIFO priority {}: {}",
+                   config.fifoPriority, std::strerror(err));
+      ok = false;
+    }
+  } else if (config.nice != 0) {
+    // On Linux nice is per thread, by tid
+    if (setpriority(PRIO_PROCESS, gettid(), config.nice) != 0) {
+      fmt::println("Couldn't set nice {}: {}", config.nice,
+                   std::strerror(errno));
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+bool LockMemory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    fmt::println("Couldn't lock memory: {}", std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+#else
+
+bool ConfigureCurrentThread(const std::vector<int> &cpus,
+                            const RealtimeConfig &config) {
+  if (!cpus.empty() || config.fifoPriority > 0 || config.nice != 0) {
+    fmt::println("Thread affinity and priority are only supported on Linux");
+    return false;
+  }
+  return true;
+}
+
+bool LockMemory() {
+  fmt::println("Memory locking is only supported on Linux");
+  return false;
+}
+
+#endif
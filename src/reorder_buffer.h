@@ -0,0 +1,89 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * Holds timestamped observations for a while so late arrivals can catch up,
+ * then hands them back sorted by capture time. Anything that shows up after
+ * its window already closed (a straggler) just goes out with the next
+ * release, so it still gets added in one batch.
+ *
+ * T needs a uint64_t timeUs member.
+ */
+template <typename T> class ReorderBuffer {
+public:
+  void Push(T item) { pending.push_back(std::move(item)); }
+
+  /**
+   * Remove and return everything captured at or before cutoffUs, oldest
+   * first
+   */
+  std::vector<T> Release(uint64_t cutoffUs) {
+    auto held = std::stable_partition(
+        pending.begin(), pending.end(),
+        [cutoffUs](const T &it) { return it.timeUs <= cutoffUs; });
+
+    std::vector<T> ret(std::make_move_iterator(pending.begin()),
+                       std::make_move_iterator(held));
+    pending.erase(pending.begin(), held);
+
+    std::stable_sort(ret.begin(), ret.end(), [](const T &a, const T &b) {
+      return a.timeUs < b.timeUs;
+    });
+
+    for (const T &it : ret) {
+      if (it.timeUs < lastCutoffUs) {
+        stragglers++;
+      }
+    }
+    lastCutoffUs = std::max(lastCutoffUs, cutoffUs);
+
+    return ret;
+  }
+
+  /**
+   * Forget everything captured at or before timeUs, eg because the localizer
+   * was reset there and it would land on states that no longer exist
+   */
+  void DropThrough(uint64_t timeUs) {
+    std::erase_if(pending,
+                  [timeUs](const T &it) { return it.timeUs <= timeUs; });
+  }
+
+  size_t Size() const { return pending.size(); }
+
+  // Total number of items released after their window had already closed
+  uint64_t Stragglers() const { return stragglers; }
+
+private:
+  std::vector<T> pending;
+  uint64_t lastCutoffUs = 0;
+  uint64_t stragglers = 0;
+};
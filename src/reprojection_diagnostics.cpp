@@ -0,0 +1,201 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "reprojection_diagnostics.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace gtsam;
+
+namespace {
+// While accumulating, rms holds the sum of squares
+void Accumulate(ResidualStats &stats, double err2) {
+  stats.corners++;
+  stats.rms += err2;
+  if (err2 > ReprojectionDiagnostics::kOutlierChi2) {
+    stats.outliers++;
+  }
+}
+
+void Finish(ResidualStats &stats) {
+  stats.rms = stats.corners > 0 ? std::sqrt(stats.rms / stats.corners) : 0;
+}
+} // namespace
+
+void ReprojectionDiagnostics::Add(Key state, uint32_t camera, int tagID,
+                                  const Pose3 &robotTcamera,
+                                  const std::vector<Point3> &worldPcorners,
+                                  const std::vector<Point2> &corners,
+                                  const Vector2 &sigmas) {
+  const size_t numCorners = std::min(worldPcorners.size(), corners.size());
+
+  observations.push_back(Observation{
+      .state = state,
+      .camera = camera,
+      .tagID = tagID,
+      .robotTcamera = robotTcamera,
+      .firstCorner = worldX.size(),
+      .numCorners = numCorners,
+  });
+
+  for (size_t i = 0; i < numCorners; i++) {
+    worldX.push_back(worldPcorners[i].x());
+    worldY.push_back(worldPcorners[i].y());
+    worldZ.push_back(worldPcorners[i].z());
+    measuredU.push_back(corners[i].x());
+    measuredV.push_back(corners[i].y());
+    invSigmaU.push_back(1.0 / sigmas.x());
+    invSigmaV.push_back(1.0 / sigmas.y());
+  }
+}
+
+void ReprojectionDiagnostics::Prune(Key oldest) {
+  // Late vision attaches to older states, so stale observations can be
+  // anywhere, not just at the front. Slide everything we keep down over them,
+  // in order. Nothing moves if nothing's stale
+  size_t kept = 0;
+  size_t keptCorners = 0;
+  for (Observation &obs : observations) {
+    if (obs.state < oldest) {
+      continue;
+    }
+    if (obs.firstCorner != keptCorners) {
+      for (auto *v : {&worldX, &worldY, &worldZ, &measuredU, &measuredV,
+                      &invSigmaU, &invSigmaV}) {
+        std::copy_n(v->begin() + obs.firstCorner, obs.numCorners,
+                    v->begin() + keptCorners);
+      }
+      obs.firstCorner = keptCorners;
+    }
+    keptCorners += obs.numCorners;
+    observations[kept++] = obs;
+  }
+
+  observations.resize(kept);
+  for (auto *v : {&worldX, &worldY, &worldZ, &measuredU, &measuredV,
+                  &invSigmaU, &invSigmaV}) {
+    v->resize(keptCorners);
+  }
+}
+
+void ReprojectionDiagnostics::Clear() {
+  observations.clear();
+  for (auto *v : {&worldX, &worldY, &worldZ, &measuredU, &measuredV,
+                  &invSigmaU, &invSigmaV}) {
+    v->clear();
+  }
+}
+
+ReprojectionSummary ReprojectionDiagnostics::Evaluate(
+    const std::function<std::optional<Pose3>(Key)> &worldTbody) {
+  ReprojectionSummary summary;
+
+  const Eigen::Index n = worldX.size();
+  if (n == 0) {
+    return summary;
+  }
+
+  // Grow-only, so steady state doesn't allocate
+  if (r00.size() < n) {
+    for (auto *a : {&r00, &r01, &r02, &r10, &r11, &r12, &r20, &r21, &r22,
+                    &tx, &ty, &tz, &valid, &camX, &camY, &camZ, &err2}) {
+      a->resize(2 * n);
+    }
+  }
+
+  // Broadcast each observation's world->camera transform out to its corners
+  for (const auto &obs : observations) {
+    const auto pose = worldTbody(obs.state);
+    const Pose3 cameraTworld = pose
+                                   ? (*pose * obs.robotTcamera).inverse()
+                                   : Pose3{};
+    const Matrix3 R = cameraTworld.rotation().matrix();
+    const Point3 &t = cameraTworld.translation();
+
+    const Eigen::Index first = obs.firstCorner;
+    const Eigen::Index count = obs.numCorners;
+    r00.segment(first, count).setConstant(R(0, 0));
+    r01.segment(first, count).setConstant(R(0, 1));
+    r02.segment(first, count).setConstant(R(0, 2));
+    r10.segment(first, count).setConstant(R(1, 0));
+    r11.segment(first, count).setConstant(R(1, 1));
+    r12.segment(first, count).setConstant(R(1, 2));
+    r20.segment(first, count).setConstant(R(2, 0));
+    r21.segment(first, count).setConstant(R(2, 1));
+    r22.segment(first, count).setConstant(R(2, 2));
+    tx.segment(first, count).setConstant(t.x());
+    ty.segment(first, count).setConstant(t.y());
+    tz.segment(first, count).setConstant(t.z());
+    valid.segment(first, count).setConstant(pose ? 1 : 0);
+  }
+
+  // And do the actual math for every corner at once
+  using ConstMap = Eigen::Map<const Eigen::ArrayXd>;
+  const ConstMap wx(worldX.data(), n);
+  const ConstMap wy(worldY.data(), n);
+  const ConstMap wz(worldZ.data(), n);
+  const ConstMap mu(measuredU.data(), n);
+  const ConstMap mv(measuredV.data(), n);
+  const ConstMap isu(invSigmaU.data(), n);
+  const ConstMap isv(invSigmaV.data(), n);
+
+  camX.head(n) = r00.head(n) * wx + r01.head(n) * wy + r02.head(n) * wz +
+                 tx.head(n);
+  camY.head(n) = r10.head(n) * wx + r11.head(n) * wy + r12.head(n) * wz +
+                 ty.head(n);
+  camZ.head(n) = r20.head(n) * wx + r21.head(n) * wy + r22.head(n) * wz +
+                 tz.head(n);
+  err2.head(n) =
+      ((camX.head(n) / camZ.head(n) - mu) * isu).square() +
+      ((camY.head(n) / camZ.head(n) - mv) * isv).square();
+  // Corners behind the camera don't have a meaningful residual
+  valid.head(n) = (camZ.head(n) > 1e-6).select(valid.head(n), 0.0);
+
+  // Tally up per camera/tag
+  for (const auto &obs : observations) {
+    ResidualStats &camera = summary.perCamera[obs.camera];
+    ResidualStats &tag = summary.perTag[obs.tagID];
+
+    const size_t first = obs.firstCorner;
+    for (size_t i = first; i < first + obs.numCorners; i++) {
+      if (valid(i) == 0) {
+        continue;
+      }
+      Accumulate(camera, err2(i));
+      Accumulate(tag, err2(i));
+      Accumulate(summary.total, err2(i));
+    }
+  }
+
+  for (auto &[_, stats] : summary.perCamera) {
+    Finish(stats);
+  }
+  for (auto &[_, stats] : summary.perTag) {
+    Finish(stats);
+  }
+  Finish(summary.total);
+
+  return summary;
+}
@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Point2.h>
+#include <gtsam/geometry/Point3.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/inference/Key.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include <Eigen/Core>
+
+struct ResidualStats {
+  size_t corners = 0;
+  // Corners whose whitened error is past the outlier threshold
+  size_t outliers = 0;
+  // RMS whitened reprojection error (so ~1 if the noise model is right)
+  double rms = 0;
+};
+
+struct ReprojectionSummary {
+  // By CameraVisionObservation::cameraIndex
+  std::map<uint32_t, ResidualStats> perCamera;
+  std::map<int, ResidualStats> perTag;
+  ResidualStats total;
+};
+
+/**
+ * Reprojection residuals for every tag observation still in the smoother
+ * window, re-evaluated against the latest estimate.
+ *
+ * Corners get packed into contiguous structure-of-arrays buffers, so the
+ * transform/project/whiten math runs as Eigen array expressions over all of
+ * them at once (and vectorizes), instead of evaluating factors one at a time.
+ */
+class ReprojectionDiagnostics {
+public:
+  // Squared whitened error past which a corner counts as an outlier (2 dof
+  // chi-square, 99%)
+  static constexpr double kOutlierChi2 = 9.21;
+
+  /**
+   * Remember an observation that made it into the graph
+   *
+   * @param state key of the state its factors are attached to
+   * @param sigmas corner noise, normalized image coordinates
+   */
+  void Add(gtsam::Key state, uint32_t camera, int tagID,
+           const gtsam::Pose3 &robotTcamera,
+           const std::vector<gtsam::Point3> &worldPcorners,
+           const std::vector<gtsam::Point2> &corners,
+           const gtsam::Vector2 &sigmas);
+
+  /**
+   * Forget observations attached to states older than oldest (keys are
+   * time-ordered, but observations aren't, since late vision attaches to
+   * older states). Everything left is packed back together, so memory
+   * tracks what's still in the window
+   */
+  void Prune(gtsam::Key oldest);
+
+  void Clear();
+
+  /**
+   * Re-evaluate everything we're holding
+   *
+   * @param worldTbody latest estimate of a state, if it still has one
+   */
+  ReprojectionSummary
+  Evaluate(const std::function<std::optional<gtsam::Pose3>(gtsam::Key)>
+               &worldTbody);
+
+  inline size_t NumObservations() const { return observations.size(); }
+
+private:
+  struct Observation {
+    gtsam::Key state;
+    uint32_t camera;
+    int tagID;
+    gtsam::Pose3 robotTcamera;
+    // First of our corners in the flat arrays
+    size_t firstCorner;
+    size_t numCorners;
+  };
+
+  // In the order they were added
+  std::vector<Observation> observations;
+
+  // Flat per-corner inputs, one entry per corner of every observation, in
+  // observation order
+  std::vector<double> worldX, worldY, worldZ;
+  std::vector<double> measuredU, measuredV;
+  std::vector<double> invSigmaU, invSigmaV;
+
+  // Per-corner world->camera transform, rebuilt every Evaluate. Reused so we
+  // don't allocate every cycle
+  Eigen::ArrayXd r00, r01, r02, r10, r11, r12, r20, r21, r22, tx, ty, tz;
+  Eigen::ArrayXd valid;
+  // Scratch, same deal
+  Eigen::ArrayXd camX, camY, camZ, err2;
+};
@@ -0,0 +1,576 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "smoother_backend.h"
+
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam_unstable/nonlinear/BatchFixedLagSmoother.h>
+#include <gtsam_unstable/nonlinear/ConcurrentBatchFilter.h>
+#include <gtsam_unstable/nonlinear/ConcurrentBatchSmoother.h>
+#include <gtsam_unstable/nonlinear/IncrementalFixedLagSmoother.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "sparsify.h"
+
+using namespace gtsam;
+
+namespace {
+
+/**
+ * Marginal covariance by factoring a whole graph ourselves, for smoothers that
+ * don't keep a Bayes tree around to pull it from. Removed factors leave null
+ * slots behind, so skip those
+ */
+Matrix MarginalCovarianceOf(const NonlinearFactorGraph &graph,
+                            const Values &estimate, Key key) {
+  NonlinearFactorGraph factors;
+  for (const auto &factor : graph) {
+    if (factor) {
+      factors.push_back(factor);
+    }
+  }
+  return Marginals(factors, estimate).marginalCovariance(key);
+}
+
+// Mark the frontals of every clique under this one that has key as a parent,
+// same as IncrementalFixedLagSmoother does before marginalizing
+void MarkAffectedKeys(Key key, const ISAM2Clique::shared_ptr &clique,
+                      std::set<Key> &additionalKeys) {
+  const auto &conditional = clique->conditional();
+  if (std::find(conditional->beginParents(), conditional->endParents(),
+                key) == conditional->endParents()) {
+    return;
+  }
+  for (Key frontal : conditional->frontals()) {
+    additionalKeys.insert(frontal);
+  }
+  for (const auto &child : clique->children) {
+    MarkAffectedKeys(key, child, additionalKeys);
+  }
+}
+
+/**
+ * IncrementalFixedLagSmoother with two optional tweaks:
+ *
+ * newestLast orders the states about to be marginalized first (like
+ * upstream), but also the states this update added (and our newest state)
+ * last. Upstream only constrains the marginalizable states, which turns off
+ * ISAM2's own "new keys last" ordering whenever anything is being
+ * marginalized -- ie every update once the window is full. Vision attaching
+ * deep in the window then drags the newest state away from the root of the
+ * Bayes tree, and reading its estimate or marginal has to walk further.
+ *
+ * sparsify swaps each dense marginal factor left by marginalization for a
+ * chain of priors (see SparsifyMarginal), in the next update.
+ */
+class OrderedFixedLagSmoother : public IncrementalFixedLagSmoother {
+public:
+  OrderedFixedLagSmoother(double lag, const ISAM2Params &params,
+                          bool newestLast, bool sparsify)
+      : IncrementalFixedLagSmoother(lag, params), newestLast(newestLast),
+        sparsify(sparsify) {}
+
+  Result update(const NonlinearFactorGraph &newFactors, const Values &newTheta,
+                const KeyTimestampMap &timestamps,
+                const FactorIndices &factorsToRemove) override {
+    if (!newestLast && !sparsify) {
+      return IncrementalFixedLagSmoother::update(newFactors, newTheta,
+                                                 timestamps, factorsToRemove);
+    }
+
+    updateKeyTimestampMap(timestamps);
+
+    const KeyVector marginalizableKeys =
+        findKeysBefore(getCurrentTimestamp() - smootherLag_);
+
+    ISAM2UpdateParams updateParams;
+    if (newestLast) {
+      // 0: about to be marginalized, 1: everything else, 2: new and newest
+      FastMap<Key, int> constrainedKeys;
+      for (Key key : isam_.getLinearizationPoint().keys()) {
+        constrainedKeys[key] = 1;
+      }
+      for (Key key : newTheta.keys()) {
+        constrainedKeys[key] = 1;
+      }
+      for (const auto &[key, time] : timestamps) {
+        constrainedKeys[key] = 2;
+      }
+      if (!timestampKeyMap_.empty()) {
+        constrainedKeys[timestampKeyMap_.rbegin()->second] = 2;
+      }
+      for (Key key : marginalizableKeys) {
+        constrainedKeys[key] = 0;
+      }
+      updateParams.constrainedKeys = std::move(constrainedKeys);
+    } else {
+      createOrderingConstraints(marginalizableKeys,
+                                updateParams.constrainedKeys);
+    }
+
+    // Everything between the marginalized states and the leaves has to be
+    // re-eliminated too, so they actually end up as leaves
+    std::set<Key> additionalKeys;
+    for (Key key : marginalizableKeys) {
+      for (const auto &child : isam_[key]->children) {
+        MarkAffectedKeys(key, child, additionalKeys);
+      }
+    }
+    updateParams.extraReelimKeys =
+        FastList<Key>(additionalKeys.begin(), additionalKeys.end());
+
+    // Swap in last update's sparsified marginals along with everything else
+    NonlinearFactorGraph factors = newFactors;
+    factors.push_back(sparsified);
+    updateParams.removeFactorIndices = factorsToRemove;
+    updateParams.removeFactorIndices.insert(
+        updateParams.removeFactorIndices.end(), denseMarginals.begin(),
+        denseMarginals.end());
+    sparsified.resize(0);
+    denseMarginals.clear();
+
+    isamResult_ = isam_.update(factors, newTheta, updateParams);
+
+    if (!marginalizableKeys.empty()) {
+      FactorIndices marginalIndices;
+      isam_.marginalizeLeaves(
+          FastList<Key>(marginalizableKeys.begin(), marginalizableKeys.end()),
+          &marginalIndices);
+      if (sparsify) {
+        SparsifyMarginals(marginalIndices);
+      }
+    }
+    eraseKeyTimestampMap(marginalizableKeys);
+
+    Result result;
+    result.iterations = 1;
+    return result;
+  }
+
+private:
+  // Queue chains for every marginal that touches more than two states (two
+  // is already a chain)
+  void SparsifyMarginals(const FactorIndices &marginalIndices) {
+    const NonlinearFactorGraph &factors = isam_.getFactorsUnsafe();
+    for (FactorIndex index : marginalIndices) {
+      const auto marginal =
+          std::dynamic_pointer_cast<LinearContainerFactor>(factors.at(index));
+      if (!marginal || marginal->size() < 3) {
+        continue;
+      }
+      const NonlinearFactorGraph chain = SparsifyMarginal(*marginal);
+      if (chain.empty()) {
+        continue;
+      }
+      sparsified.push_back(chain);
+      denseMarginals.push_back(index);
+    }
+  }
+
+  bool newestLast;
+  bool sparsify;
+
+  // Replacements for denseMarginals, added (and those removed) next update
+  NonlinearFactorGraph sparsified;
+  FactorIndices denseMarginals;
+};
+
+/**
+ * ISAM2 under the hood. Cheap on average, but relinearization and fill-in
+ * make the worst case spiky.
+ */
+class Isam2Backend : public SmootherBackend {
+public:
+  Isam2Backend(double lag, const Isam2Config &config)
+      : newestLast(config.ordering == "constrained"),
+        sparsify(config.sparsifyMarginals) {
+    if (config.ordering != "colamd" && config.ordering != "constrained") {
+      throw std::runtime_error(
+          fmt::format("Unknown ISAM2 ordering: {}", config.ordering));
+    }
+
+    ISAM2Params parameters;
+    if (config.factorization == "cholesky") {
+      parameters.factorization = ISAM2Params::CHOLESKY;
+    } else if (config.factorization == "qr") {
+      parameters.factorization = ISAM2Params::QR;
+    } else {
+      throw std::runtime_error(
+          fmt::format("Unknown ISAM2 factorization: {}", config.factorization));
+    }
+    // parameters.relinearizeThreshold = 0.01;
+    // parameters.relinearizeSkip = 1;
+    // parameters.cacheLinearizedFactors = false;
+    // parameters.enableDetailedResults = true;
+    parameters.findUnusedFactorSlots = true;
+    parameters.print();
+
+    smoother = OrderedFixedLagSmoother(lag, parameters, newestLast, sparsify);
+  }
+
+  void Update(const NonlinearFactorGraph &newFactors, const Values &newValues,
+              const KeyTimestampMap &newTimestamps,
+              const FactorIndices &factorsToRemove) override {
+    smoother.update(newFactors, newValues, newTimestamps, factorsToRemove);
+  }
+
+  void Clear() override {
+    smoother = OrderedFixedLagSmoother(
+        smoother.smootherLag(), smoother.params(), newestLast, sparsify);
+  }
+
+  Values CalculateEstimate() const override {
+    return smoother.calculateEstimate();
+  }
+  Pose3 CalculatePose(Key key) const override {
+    return smoother.calculateEstimate<Pose3>(key);
+  }
+  Pose2 CalculatePose2(Key key) const override {
+    return smoother.calculateEstimate<Pose2>(key);
+  }
+  Matrix MarginalCovariance(Key key) const override {
+    return smoother.marginalCovariance(key);
+  }
+
+  const KeyTimestampMap &Timestamps() const override {
+    return smoother.timestamps();
+  }
+  NonlinearFactorGraph Factors() const override {
+    return smoother.getFactors();
+  }
+
+  void Print() const override {
+    smoother.print();
+    smoother.getISAM2().getFactorsUnsafe().print();
+  }
+
+  const ISAM2 *GetISAM2() const override { return &smoother.getISAM2(); }
+
+private:
+  bool newestLast;
+  bool sparsify;
+  OrderedFixedLagSmoother smoother{0, ISAM2Params{}, false, false};
+};
+
+/**
+ * Levenberg-Marquardt over the whole window, every update. More work per
+ * update than ISAM2, but for short windows the worst case is flatter and
+ * there's no linearization point drift.
+ */
+class BatchBackend : public SmootherBackend {
+public:
+  explicit BatchBackend(double lag)
+      : smoother(lag, LevenbergMarquardtParams{}) {}
+
+  void Update(const NonlinearFactorGraph &newFactors, const Values &newValues,
+              const KeyTimestampMap &newTimestamps,
+              const FactorIndices &factorsToRemove) override {
+    smoother.update(newFactors, newValues, newTimestamps, factorsToRemove);
+  }
+
+  void Clear() override {
+    smoother = BatchFixedLagSmoother(smoother.smootherLag(), smoother.params());
+  }
+
+  Values CalculateEstimate() const override {
+    return smoother.calculateEstimate();
+  }
+  Pose3 CalculatePose(Key key) const override {
+    return smoother.calculateEstimate<Pose3>(key);
+  }
+  Pose2 CalculatePose2(Key key) const override {
+    return smoother.calculateEstimate<Pose2>(key);
+  }
+  Matrix MarginalCovariance(Key key) const override {
+    return MarginalCovarianceOf(smoother.getFactors(),
+                                smoother.calculateEstimate(), key);
+  }
+
+  const KeyTimestampMap &Timestamps() const override {
+    return smoother.timestamps();
+  }
+  NonlinearFactorGraph Factors() const override {
+    return smoother.getFactors();
+  }
+
+  void Print() const override {
+    smoother.print();
+    smoother.getFactors().print();
+  }
+
+private:
+  BatchFixedLagSmoother smoother;
+};
+
+/**
+ * ConcurrentBatchSmoother that can marginalize its oldest states into factors
+ * on the states they touched, the way BatchFixedLagSmoother does. Upstream
+ * keeps everything it's ever been handed.
+ */
+class WindowedBatchSmoother : public ConcurrentBatchSmoother {
+public:
+  // Whether we hold key and the filter isn't still using it as a separator
+  bool Marginalizable(Key key) const {
+    return theta_.exists(key) && !separatorValues_.exists(key);
+  }
+
+  /**
+   * Marginalize keys out, then re-optimize what's left
+   *
+   * @param keys states to drop, each one Marginalizable
+   */
+  Result update(const KeyVector &keys) {
+    if (keys.empty()) {
+      return ConcurrentBatchSmoother::update();
+    }
+
+    const KeySet marginalized(keys.begin(), keys.end());
+    NonlinearFactorGraph involved;
+    std::vector<size_t> slots;
+    for (size_t slot = 0; slot < factors_.size(); slot++) {
+      const auto &factor = factors_.at(slot);
+      if (factor && std::any_of(factor->begin(), factor->end(), [&](Key key) {
+            return marginalized.contains(key);
+          })) {
+        involved.push_back(factor);
+        slots.push_back(slot);
+      }
+    }
+    const NonlinearFactorGraph marginals =
+        BatchFixedLagSmoother::CalculateMarginalFactors(involved, theta_,
+                                                        keys);
+
+    // Nothing references them once their factors are gone
+    for (Key key : keys) {
+      theta_.erase(key);
+      delta_.erase(key);
+    }
+    return ConcurrentBatchSmoother::update(marginals, Values{}, slots);
+  }
+};
+
+/**
+ * A small batch filter over just the last filterLag of states, fed every
+ * update, with a batch smoother over the rest of the window re-optimizing on
+ * the worker pool and syncing back into the filter whenever it finishes.
+ * Update() only ever waits on the filter, so a slow smoother pass can't stall
+ * our output. Without a pool the smoother runs inline instead.
+ *
+ * Each pass first marginalizes out whatever has fallen behind the lag, so the
+ * smoother stays the size of the window. Passes start at most every
+ * kSmootherPeriod of state time, and only once the filter has handed over new
+ * states, rather than back to back.
+ */
+class ConcurrentBackend : public SmootherBackend {
+public:
+  // States younger than this stay in the filter, uS. Older ones live in the
+  // smoother until they're lag old
+  static constexpr double kFilterLag = 0.5 * 1e6;
+  // Least state time between the start of one smoother pass and the next, uS
+  static constexpr double kSmootherPeriod = 0.1 * 1e6;
+
+  ConcurrentBackend(double lag, WorkerPool *pool) : lag(lag), pool(pool) {}
+  ~ConcurrentBackend() override { WaitForSmoother(); }
+
+  void Update(const NonlinearFactorGraph &newFactors, const Values &newValues,
+              const KeyTimestampMap &newTimestamps,
+              const FactorIndices &factorsToRemove) override {
+    for (const auto &[key, time] : newTimestamps) {
+      filterTimestamps[key] = time;
+      newest = std::max(newest, time);
+    }
+
+    bool handedOver = false;
+    {
+      std::lock_guard lock{filterMutex};
+
+      // Hand anything that's aged out of the filter over to the smoother
+      FastList<Key> keysToMove;
+      for (auto it = filterTimestamps.begin(); it != filterTimestamps.end();) {
+        if (it->second < newest - kFilterLag) {
+          keysToMove.push_back(it->first);
+          smootherTimestamps.insert(*it);
+          it = filterTimestamps.erase(it);
+        } else {
+          it++;
+        }
+      }
+
+      filter.update(newFactors, newValues, keysToMove,
+                    std::vector<size_t>(factorsToRemove.begin(),
+                                        factorsToRemove.end()));
+      handedOver = !keysToMove.empty();
+    }
+
+    // And kick the smoother, if it has something new and isn't already busy
+    {
+      std::lock_guard lock{smootherMutex};
+      smootherPending = smootherPending || handedOver;
+      if (smootherRunning || !smootherPending ||
+          newest - lastPassTime < kSmootherPeriod) {
+        return;
+      }
+      smootherRunning = true;
+      smootherPending = false;
+      lastPassTime = newest;
+    }
+    const double cutoff = newest - lag;
+    if (pool) {
+      pool->Post([this, cutoff] { RunSmoother(cutoff); });
+    } else {
+      RunSmoother(cutoff);
+    }
+  }
+
+  void Clear() override {
+    WaitForSmoother();
+    filter = ConcurrentBatchFilter{};
+    smoother = WindowedBatchSmoother{};
+    filterTimestamps.clear();
+    smootherTimestamps.clear();
+    newest = 0;
+    lastPassTime = -std::numeric_limits<double>::infinity();
+  }
+
+  Values CalculateEstimate() const override {
+    std::lock_guard lock{filterMutex};
+    return filter.calculateEstimate();
+  }
+  Pose3 CalculatePose(Key key) const override {
+    std::lock_guard lock{filterMutex};
+    return filter.calculateEstimate<Pose3>(key);
+  }
+  Pose2 CalculatePose2(Key key) const override {
+    std::lock_guard lock{filterMutex};
+    return filter.calculateEstimate<Pose2>(key);
+  }
+  Matrix MarginalCovariance(Key key) const override {
+    // The filter carries the smoother's summary of everything older, so this
+    // is the full marginal
+    std::lock_guard lock{filterMutex};
+    return MarginalCovarianceOf(filter.getFactors(),
+                                filter.calculateEstimate(), key);
+  }
+
+  // Only what's still in the filter -- new factors can't reach further back
+  const KeyTimestampMap &Timestamps() const override {
+    return filterTimestamps;
+  }
+  NonlinearFactorGraph Factors() const override {
+    std::lock_guard lock{filterMutex};
+    return filter.getFactors();
+  }
+
+  void Print() const override {
+    std::lock_guard lock{filterMutex};
+    filter.print();
+  }
+
+private:
+  // One smoother pass, dropping states older than cutoff first
+  void RunSmoother(double cutoff) {
+    try {
+      KeyVector marginalizableKeys;
+      {
+        // Swap marginalized states/summaries with the filter. Quick
+        std::lock_guard lock{filterMutex};
+        synchronize(filter, smoother);
+
+        for (auto it = smootherTimestamps.begin();
+             it != smootherTimestamps.end();) {
+          if (it->second < cutoff && smoother.Marginalizable(it->first)) {
+            marginalizableKeys.push_back(it->first);
+            it = smootherTimestamps.erase(it);
+          } else {
+            it++;
+          }
+        }
+      }
+      // The slow part, while the filter keeps going without us
+      smoother.update(marginalizableKeys);
+    } catch (const std::exception &e) {
+      fmt::println("Concurrent smoother update failed: {}", e.what());
+    }
+
+    std::lock_guard lock{smootherMutex};
+    smootherRunning = false;
+    smootherDone.notify_all();
+  }
+
+  // Let the pass in flight (if any) finish
+  void WaitForSmoother() {
+    std::unique_lock lock{smootherMutex};
+    smootherDone.wait(lock, [this] { return !smootherRunning; });
+    smootherPending = false;
+  }
+
+  double lag;
+  WorkerPool *pool;
+
+  // Guards the filter, and smootherTimestamps, against the smoother pass
+  // syncing with it
+  mutable std::mutex filterMutex;
+  ConcurrentBatchFilter filter;
+  // Only ever touched by the smoother pass (or with none running)
+  WindowedBatchSmoother smoother;
+
+  // Times of states still in the filter, and of those handed to the smoother
+  KeyTimestampMap filterTimestamps;
+  KeyTimestampMap smootherTimestamps;
+  // Newest state time we've seen, uS
+  double newest = 0;
+
+  std::mutex smootherMutex;
+  std::condition_variable smootherDone;
+  bool smootherRunning = false;
+  // The filter has handed over states since the last pass started
+  bool smootherPending = false;
+  // Newest state time when the last pass started, uS
+  double lastPassTime = -std::numeric_limits<double>::infinity();
+};
+
+} // namespace
+
+std::unique_ptr<SmootherBackend>
+MakeSmootherBackend(std::string_view name, double lag,
+                    const Isam2Config &isam2, WorkerPool *pool) {
+  if (name == "isam2") {
+    return std::make_unique<Isam2Backend>(lag, isam2);
+  }
+  if (name == "batch") {
+    return std::make_unique<BatchBackend>(lag);
+  }
+  if (name == "concurrent") {
+    return std::make_unique<ConcurrentBackend>(lag, pool);
+  }
+  throw std::runtime_error(fmt::format("Unknown smoother backend: {}", name));
+}
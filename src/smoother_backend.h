@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Pose2.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/nonlinear/FixedLagSmoother.h>
+#include <gtsam/nonlinear/ISAM2.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include <memory>
+#include <string_view>
+
+#include "config.h"
+#include "worker_pool.h"
+
+/**
+ * The fixed-lag smoother a Localizer hands its factors to. Lets us swap the
+ * optimizer out from the config without the Localizer caring which it got.
+ */
+class SmootherBackend {
+public:
+  using Key = gtsam::Key;
+  using KeyTimestampMap = gtsam::FixedLagSmoother::KeyTimestampMap;
+
+  virtual ~SmootherBackend() = default;
+
+  /**
+   * Add new factors/states and re-optimize
+   */
+  virtual void Update(const gtsam::NonlinearFactorGraph &newFactors,
+                      const gtsam::Values &newValues,
+                      const KeyTimestampMap &newTimestamps,
+                      const gtsam::FactorIndices &factorsToRemove) = 0;
+
+  /**
+   * Drop everything, keeping our settings
+   */
+  virtual void Clear() = 0;
+
+  virtual gtsam::Values CalculateEstimate() const = 0;
+  virtual gtsam::Pose3 CalculatePose(Key key) const = 0;
+  // For planar localizers
+  virtual gtsam::Pose2 CalculatePose2(Key key) const = 0;
+  virtual gtsam::Matrix MarginalCovariance(Key key) const = 0;
+
+  // Every state still in the window, and its time
+  virtual const KeyTimestampMap &Timestamps() const = 0;
+  // Every factor still in the window. May contain nulls for removed factors.
+  // A copy, since the concurrent backend's can change under us
+  virtual gtsam::NonlinearFactorGraph Factors() const = 0;
+
+  virtual void Print() const = 0;
+
+  // The ISAM2 underneath, for looking at the shape of its Bayes tree. Null
+  // for backends that don't have one
+  virtual const gtsam::ISAM2 *GetISAM2() const { return nullptr; }
+};
+
+/**
+ * Make a backend by config name: "isam2" (the default), "batch" or
+ * "concurrent". Throws if we don't know the name.
+ *
+ * @param lag how long to keep states for, in the same units as our
+ * timestamps (uS)
+ * @param isam2 ordering/factorization, only used by "isam2"
+ * @param pool where "concurrent" runs its smoother passes. Must outlive the
+ * backend. Without one they run inline
+ */
+std::unique_ptr<SmootherBackend>
+MakeSmootherBackend(std::string_view name, double lag,
+                    const Isam2Config &isam2 = {}, WorkerPool *pool = nullptr);
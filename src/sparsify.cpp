@@ -0,0 +1,143 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sparsify.h"
+
+#include <gtsam/geometry/Pose2.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/GaussianFactor.h>
+#include <gtsam/slam/BetweenFactor.h>
+
+#include <iterator>
+#include <map>
+
+#include <Eigen/Cholesky>
+
+using namespace gtsam;
+
+namespace {
+
+struct Block {
+  Eigen::Index offset;
+  Eigen::Index dim;
+};
+
+// Covariance can't be turned into a noise model if it's not positive definite
+bool PositiveDefinite(const Matrix &covariance) {
+  return Eigen::LLT<Matrix>(covariance).info() == Eigen::Success;
+}
+
+template <typename T>
+NonlinearFactorGraph Chain(const std::map<Key, Block> &blocks,
+                           const Values &mean, const Matrix &covariance) {
+  constexpr Eigen::Index kDim = traits<T>::dimension;
+  for (const auto &[key, block] : blocks) {
+    if (block.dim != kDim || !mean.exists<T>(key)) {
+      return {};
+    }
+  }
+
+  NonlinearFactorGraph chain;
+
+  // Oldest state just keeps its marginal
+  auto it = blocks.begin();
+  const Matrix first =
+      covariance.block(it->second.offset, it->second.offset, kDim, kDim);
+  if (!PositiveDefinite(first)) {
+    return {};
+  }
+  chain.addPrior(it->first, mean.at<T>(it->first),
+                 noiseModel::Gaussian::Covariance(first));
+
+  for (auto next = std::next(it); next != blocks.end(); it = next++) {
+    Eigen::Matrix<double, kDim, kDim> Hfrom;
+    Eigen::Matrix<double, kDim, kDim> Hto;
+    const T between = mean.at<T>(it->first)
+                          .between(mean.at<T>(next->first), Hfrom, Hto);
+
+    // Joint covariance of the two states, pushed through between()
+    Matrix joint(2 * kDim, 2 * kDim);
+    const Eigen::Index from = it->second.offset;
+    const Eigen::Index to = next->second.offset;
+    joint << covariance.block(from, from, kDim, kDim),
+        covariance.block(from, to, kDim, kDim),
+        covariance.block(to, from, kDim, kDim),
+        covariance.block(to, to, kDim, kDim);
+    Matrix J(kDim, 2 * kDim);
+    J << Hfrom, Hto;
+    const Matrix measured = J * joint * J.transpose();
+    if (!PositiveDefinite(measured)) {
+      return {};
+    }
+
+    chain.emplace_shared<BetweenFactor<T>>(
+        it->first, next->first, between,
+        noiseModel::Gaussian::Covariance(measured));
+  }
+
+  return chain;
+}
+
+} // namespace
+
+NonlinearFactorGraph SparsifyMarginal(const LinearContainerFactor &marginal) {
+  const auto &linearizationPoint = marginal.linearizationPoint();
+  const GaussianFactor::shared_ptr &linear = marginal.factor();
+  if (!linearizationPoint || !linear || linear->size() < 2) {
+    return {};
+  }
+
+  // Where each state sits in the information matrix, in key (time) order
+  std::map<Key, Block> blocks;
+  Eigen::Index size = 0;
+  for (auto key = linear->begin(); key != linear->end(); key++) {
+    const auto dim = static_cast<Eigen::Index>(linear->getDim(key));
+    blocks[*key] = {size, dim};
+    size += dim;
+  }
+
+  const Eigen::LLT<Matrix> information(linear->information());
+  if (information.info() != Eigen::Success) {
+    return {};
+  }
+  const Matrix covariance = information.solve(Matrix::Identity(size, size));
+
+  // The marginal's mean isn't quite its linearization point
+  const VectorValues gradient = linear->gradientAtZero();
+  Vector stacked(size);
+  for (const auto &[key, block] : blocks) {
+    stacked.segment(block.offset, block.dim) = gradient.at(key);
+  }
+  const Vector step = -information.solve(stacked);
+  VectorValues delta;
+  for (const auto &[key, block] : blocks) {
+    delta.insert(key, step.segment(block.offset, block.dim));
+  }
+  const Values mean = linearizationPoint->retract(delta);
+
+  if (auto chain = Chain<Pose3>(blocks, mean, covariance); !chain.empty()) {
+    return chain;
+  }
+  return Chain<Pose2>(blocks, mean, covariance);
+}
@@ -0,0 +1,46 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/nonlinear/LinearContainerFactor.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+
+/**
+ * Nonlinear factor recovery for the marginal factors a fixed-lag smoother
+ * leaves on its boundary states. Those come out dense (every state connected
+ * to every other), so we swap them for a chain instead: a prior on the
+ * oldest state, and a between factor from each state to the next. For a tree
+ * like that, the closed-form recovery (each measurement's covariance
+ * propagated from the marginal's) is also the KL-optimal one. We don't search
+ * for a better topology than the chain, though.
+ *
+ * States have to be all Pose3 or all Pose2, and are chained in key order,
+ * which for our X(timeUs) keys is time order.
+ *
+ * @return the chain, or nothing if the marginal doesn't fit those rules or
+ * isn't positive definite (keep the dense one then)
+ */
+gtsam::NonlinearFactorGraph
+SparsifyMarginal(const gtsam::LinearContainerFactor &marginal);
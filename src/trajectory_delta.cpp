@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trajectory_delta.h"
+
+using namespace trajectory_delta;
+
+TrajectoryDeltaEncoder::TrajectoryDeltaEncoder(TrajectoryConfig config)
+    : config(config) {}
+
+bool TrajectoryDeltaEncoder::ShouldSend(
+    const Timestamped<frc::Pose3d> &pose) const {
+  const auto it = sent.find(pose.time);
+  if (it == sent.end()) {
+    // new to the receiver
+    return true;
+  }
+
+  const frc::Pose3d correction = pose.value.RelativeTo(it->second);
+  return correction.Translation().Norm().value() > config.transThreshold ||
+         correction.Rotation().Angle().value() > config.rotThreshold;
+}
+
+std::span<const uint8_t> TrajectoryDeltaEncoder::Encode(
+    const std::vector<Timestamped<frc::Pose3d>> &history) {
+  const bool keyframe = forceKeyframe || config.keyframeInterval <= 1 ||
+                        seq % config.keyframeInterval == 0;
+  forceKeyframe = false;
+
+  const uint64_t oldestUs = history.empty() ? 0 : history.front().time;
+
+  // Forget whatever fell out of history, the receiver will too
+  sent.erase(sent.begin(), sent.lower_bound(oldestUs));
+
+  buffer.resize(kHeaderSize + history.size() * kEntrySize);
+  std::span<uint8_t> out{buffer};
+
+  uint32_t count = 0;
+  for (const auto &pose : history) {
+    if (!keyframe && !ShouldSend(pose)) {
+      continue;
+    }
+
+    auto entry = out.subspan(kHeaderSize + count * kEntrySize, kEntrySize);
+    wpi::PackStruct<0>(entry, pose.time);
+    wpi::PackStruct<8>(entry, pose.value);
+    sent.insert_or_assign(pose.time, pose.value);
+    count++;
+  }
+
+  wpi::PackStruct<0>(out, seq);
+  wpi::PackStruct<4>(out, keyframe ? kKeyframeFlag : uint8_t{0});
+  wpi::PackStruct<5>(out, count);
+  wpi::PackStruct<9>(out, oldestUs);
+
+  seq++;
+
+  return out.first(kHeaderSize + count * kEntrySize);
+}
+
+bool TrajectoryDeltaDecoder::Decode(std::span<const uint8_t> message) {
+  if (message.size() < kHeaderSize) {
+    synced = false;
+    return false;
+  }
+
+  const auto seq = wpi::UnpackStruct<uint32_t, 0>(message);
+  const auto flags = wpi::UnpackStruct<uint8_t, 4>(message);
+  const auto count = wpi::UnpackStruct<uint32_t, 5>(message);
+  const auto oldestUs = wpi::UnpackStruct<uint64_t, 9>(message);
+
+  if (message.size() != kHeaderSize + count * kEntrySize) {
+    synced = false;
+    return false;
+  }
+
+  if (flags & kKeyframeFlag) {
+    trajectory.clear();
+    synced = true;
+  } else if (!synced || seq != lastSeq + 1) {
+    // Can't trust anything until the next keyframe
+    synced = false;
+    return false;
+  }
+  lastSeq = seq;
+
+  trajectory.erase(trajectory.begin(), trajectory.lower_bound(oldestUs));
+  for (uint32_t i = 0; i < count; i++) {
+    auto entry = message.subspan(kHeaderSize + i * kEntrySize, kEntrySize);
+    trajectory.insert_or_assign(wpi::UnpackStruct<uint64_t, 0>(entry),
+                                wpi::UnpackStruct<frc::Pose3d, 8>(entry));
+  }
+
+  return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+#include <frc/geometry/Pose3d.h>
+#include <wpi/struct/Struct.h>
+
+#include "config.h"
+#include "gtsam_utils.h"
+
+/**
+ * Wire format for trajectory history, so we don't resend hundreds of poses
+ * that haven't moved every time we publish. All little endian.
+ *
+ * Header:
+ *   uint32 seq        -- one more than the last message
+ *   uint8  flags      -- bit 0 set on keyframes
+ *   uint32 count      -- poses that follow
+ *   uint64 oldestUs   -- anything older than this has dropped out of history
+ * Then count of:
+ *   uint64 timeUs
+ *   Pose3d pose       -- struct:Pose3d layout
+ *
+ * Keyframes carry the whole history and replace whatever the receiver had.
+ * Deltas carry new poses, plus old poses the smoother has moved more than a
+ * threshold since we last sent them.
+ */
+namespace trajectory_delta {
+constexpr uint8_t kKeyframeFlag = 1;
+constexpr size_t kHeaderSize = 4 + 1 + 4 + 8;
+constexpr size_t kEntrySize = 8 + wpi::Struct<frc::Pose3d>::GetSize();
+} // namespace trajectory_delta
+
+class TrajectoryDeltaEncoder {
+public:
+  explicit TrajectoryDeltaEncoder(TrajectoryConfig config);
+
+  /**
+   * Encode the next message.
+   *
+   * @param history poses sorted oldest first
+   * @return the message. Only valid until the next call
+   */
+  std::span<const uint8_t>
+  Encode(const std::vector<Timestamped<frc::Pose3d>> &history);
+
+  // Make the next message a keyframe, eg when a new subscriber shows up
+  inline void ForceKeyframe() { forceKeyframe = true; }
+
+  inline uint32_t Sequence() const { return seq; }
+
+private:
+  bool ShouldSend(const Timestamped<frc::Pose3d> &pose) const;
+
+  TrajectoryConfig config;
+
+  uint32_t seq = 0;
+  bool forceKeyframe = true;
+
+  // What the receiver should currently have
+  std::map<uint64_t, frc::Pose3d> sent;
+  // Reused between messages
+  std::vector<uint8_t> buffer;
+};
+
+/**
+ * The other end of TrajectoryDeltaEncoder. Robot code would do the same
+ * thing; this lives here mostly for testing.
+ */
+class TrajectoryDeltaDecoder {
+public:
+  /**
+   * Apply one message
+   *
+   * @return false if we've lost sync (missed a message, or haven't seen a
+   * keyframe yet) and dropped it
+   */
+  bool Decode(std::span<const uint8_t> message);
+
+  inline bool Synced() const { return synced; }
+  inline const std::map<uint64_t, frc::Pose3d> &Trajectory() const {
+    return trajectory;
+  }
+
+private:
+  bool synced = false;
+  uint32_t lastSeq = 0;
+  std::map<uint64_t, frc::Pose3d> trajectory;
+};
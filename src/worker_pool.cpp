@@ -0,0 +1,160 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <utility>
+
+WorkerPool::WorkerPool(int numThreads, std::function<void()> onThreadStart_)
+    : onThreadStart(std::move(onThreadStart_)) {
+  if (numThreads <= 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+#ifdef GTSAM_USE_TBB
+  tbbLimit = std::make_unique<tbb::global_control>(
+      tbb::global_control::max_allowed_parallelism, numThreads);
+  if (onThreadStart) {
+    tbbObserver = std::make_unique<TbbObserver>(onThreadStart);
+  }
+#endif
+
+  // The caller of ParallelFor always does work, so we need one fewer
+  threads.reserve(numThreads - 1);
+  for (int i = 0; i < numThreads - 1; i++) {
+    threads.emplace_back([this] {
+      if (onThreadStart) {
+        onThreadStart();
+      }
+      WorkerLoop();
+    });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+void WorkerPool::Submit(std::function<void()> task) {
+  {
+    std::lock_guard lock(mutex);
+    tasks.push_back(std::move(task));
+  }
+  cv.notify_one();
+}
+
+void WorkerPool::Post(std::function<void()> task) {
+  if (threads.empty()) {
+    task();
+    return;
+  }
+  Submit(std::move(task));
+}
+
+void WorkerPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex);
+      cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (stopping && tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void WorkerPool::ParallelFor(size_t n, const std::function<void(size_t)> &fn) {
+  if (n == 0) {
+    return;
+  }
+  if (n == 1 || threads.empty()) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+
+  // Helpers may get scheduled after we've already returned, so everything
+  // they touch lives here. They only dereference fn if they claim an index,
+  // and we don't return until every index has finished.
+  struct State {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    size_t n;
+    const std::function<void(size_t)> *fn;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::exception_ptr error;
+  };
+  auto state = std::make_shared<State>();
+  state->n = n;
+  state->fn = &fn;
+
+  auto drain = [state] {
+    size_t i;
+    while ((i = state->next.fetch_add(1)) < state->n) {
+      try {
+        (*state->fn)(i);
+      } catch (...) {
+        std::lock_guard lock(state->mutex);
+        if (!state->error) {
+          state->error = std::current_exception();
+        }
+      }
+
+      if (state->done.fetch_add(1) + 1 == state->n) {
+        std::lock_guard lock(state->mutex);
+        state->cv.notify_all();
+      }
+    }
+  };
+
+  size_t helpers = std::min(n - 1, threads.size());
+  for (size_t h = 0; h < helpers; h++) {
+    Submit(drain);
+  }
+  drain();
+
+  std::unique_lock lock(state->mutex);
+  state->cv.wait(lock, [&state] { return state->done == state->n; });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
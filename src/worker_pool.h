@@ -0,0 +1,122 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/config.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef GTSAM_USE_TBB
+#include <tbb/global_control.h>
+#include <tbb/task_scheduler_observer.h>
+#endif
+
+/**
+ * Fixed-size pool of worker threads shared by everything in the process.
+ * When GTSAM is built with TBB, its scheduler is capped to the same number of
+ * threads, so several localizers don't each spin up a full set of workers and
+ * fight over cores.
+ */
+class WorkerPool {
+public:
+  /**
+   * @param numThreads total threads, including the caller. 0 means one per
+   * hardware core
+   * @param onThreadStart run first thing on each of our threads (and TBB's,
+   * if GTSAM uses it), eg to pin them. Not run on the caller
+   */
+  explicit WorkerPool(int numThreads = 0,
+                      std::function<void()> onThreadStart = {});
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  /**
+   * Total parallelism, counting the calling thread
+   */
+  size_t Concurrency() const { return threads.size() + 1; }
+
+  /**
+   * Run fn(i) for every i in [0, n) and wait for all of them. The calling
+   * thread takes work too, so this is safe to nest from inside another
+   * ParallelFor. The first exception thrown by fn is rethrown here.
+   */
+  void ParallelFor(size_t n, const std::function<void(size_t)> &fn);
+
+  /**
+   * Run task on one of our threads and return straight away. Long tasks tie
+   * that thread up, which only costs ParallelFor some helpers since its
+   * caller works too. With no threads of our own, task just runs here.
+   */
+  void Post(std::function<void()> task);
+
+private:
+  void Submit(std::function<void()> task);
+  void WorkerLoop();
+
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::function<void()>> tasks;
+  bool stopping = false;
+
+  std::function<void()> onThreadStart;
+
+#ifdef GTSAM_USE_TBB
+  std::unique_ptr<tbb::global_control> tbbLimit;
+
+  // Runs onThreadStart on TBB's workers as they join in
+  class TbbObserver : public tbb::task_scheduler_observer {
+  public:
+    explicit TbbObserver(const std::function<void()> &onThreadStart)
+        : onThreadStart(onThreadStart) {
+      observe(true);
+    }
+    ~TbbObserver() { observe(false); }
+
+    // Called every time a thread enters the arena, not just the first, and
+    // onThreadStart may be far from cheap (syscalls to pin and renice)
+    void on_scheduler_entry(bool isWorker) override {
+      thread_local bool started = false;
+      if (isWorker && !started) {
+        started = true;
+        onThreadStart();
+      }
+    }
+
+  private:
+    const std::function<void()> &onThreadStart;
+  };
+  std::unique_ptr<TbbObserver> tbbObserver;
+#endif
+};
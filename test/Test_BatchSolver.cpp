@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "batch_solver.h"
+#include "model_registry.h"
+#include "tag_fixtures.h"
+
+using namespace gtsam;
+
+namespace {
+// Driving straight at the tags at 0.5m/s
+Pose3 Truth(uint64_t timeUs) {
+  return Pose3{Rot3{},
+               Point3{0.5 * (static_cast<double>(timeUs) - 1000) * 1e-6, 0, 0}};
+}
+} // namespace
+
+TEST(BatchSolverTest, VisionFixesOdometryScale) {
+  const frc::AprilTagFieldLayout layout = TwoTagLayout();
+  const TagModel model{layout};
+
+  ModelRegistry registry;
+  const SharedNoiseModel &odomNoise = registry.InternNoise(
+      (Vector(6) << 0.01, 0.01, 0.01, 0.05, 0.05, 0.05).finished());
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2{0.002, 0.002});
+
+  // 2s of 50Hz odometry that reads 10% long
+  std::vector<OdometryObservation> odometry;
+  for (uint64_t k = 1; k <= 100; k++) {
+    odometry.push_back(
+        {1000 + 20000 * k, Pose3{Rot3{}, Point3{0.011, 0, 0}}, &odomNoise});
+  }
+  // and perfect vision at 10Hz, landing exactly on each keyframe
+  std::vector<CameraVisionObservation> vision;
+  for (uint64_t j = 1; j < 20; j++) {
+    const uint64_t timeUs = 1000 + 100000 * j;
+    for (int tag : {1, 2}) {
+      vision.push_back(Observe(model, tag, Truth(timeUs), timeUs, cameraNoise));
+    }
+  }
+
+  const Timestamped<Pose3WithNoise> prior{
+      1000, {Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1)}};
+  const BatchResult result =
+      SolveBatch(prior, odometry, vision, BatchConfig{}, layout);
+
+  // The prior's state, and one per 100ms
+  ASSERT_EQ(21u, result.trajectory.size());
+  // A prior, 20 odometry deltas and every corner of every frame
+  EXPECT_EQ(1u + 20 + 19 * 2 * 4, result.numFactors);
+  EXPECT_LE(result.finalError, result.initialError + 1e-9);
+
+  // Dead reckoning ends up 10cm long
+  for (const auto &[time, pose] : result.trajectory) {
+    EXPECT_LT(pose.range(Truth(time)), 0.02) << "at " << time;
+  }
+}
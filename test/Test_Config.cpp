@@ -24,9 +24,56 @@
 
 #include <gtest/gtest.h>
 
+#include <stdexcept>
+
+#include <wpi/json.h>
+
 #include "config.h"
 
 TEST(ConfigTest, LoadGood) {
   LocalizerConfig config = ParseConfig("test/resources/good_config.json");
   config.print();
 }
+
+TEST(ConfigTest, LoadSingleRobotAsNode) {
+  NodeConfig config = ParseNodeConfig("test/resources/good_config.json");
+  config.print();
+
+  ASSERT_EQ(1u, config.robots.size());
+  EXPECT_EQ(config.ntServerURI, config.robots[0].ntServerURI);
+}
+
+TEST(ConfigTest, LoadMultiRobot) {
+  NodeConfig config = ParseNodeConfig("test/resources/multi_robot.json");
+  config.print();
+
+  EXPECT_EQ(4, config.workerThreads);
+  EXPECT_EQ(std::vector<int>{0}, config.realtime.mainCpus);
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), config.realtime.workerCpus);
+  EXPECT_EQ(0, config.realtime.fifoPriority);
+  EXPECT_EQ(-5, config.realtime.nice);
+  EXPECT_FALSE(config.realtime.lockMemory);
+  ASSERT_EQ(2u, config.robots.size());
+  EXPECT_EQ("/gtsam_meme/robot2", config.robots[1].rootTableName);
+  EXPECT_EQ(2u, config.robots[1].cameras.size());
+  EXPECT_EQ(100, config.robots[1].cameras[0].queueDepth);
+  EXPECT_EQ(20, config.robots[1].cameras[1].queueDepth);
+  EXPECT_EQ(50, config.robots[1].odomQueueDepth);
+  EXPECT_EQ("drop", config.robots[1].odomOverflow);
+  EXPECT_EQ("coalesce", config.robots[0].odomOverflow);
+  // inherited from the node
+  EXPECT_EQ("127.0.0.1", config.robots[1].ntServerURI);
+}
+
+TEST(ConfigTest, RejectsBadUndistortionTable) {
+  const wpi::json good{{"subtableName", "cam"}, {"pixelNoise", 1}};
+  EXPECT_NO_THROW(good.get<CameraConfig>());
+
+  wpi::json zeroStep = good;
+  zeroStep["undistortLutStep"] = 0;
+  EXPECT_THROW(zeroStep.get<CameraConfig>(), std::runtime_error);
+
+  wpi::json negativeWidth = good;
+  negativeWidth["imageWidth"] = -640;
+  EXPECT_THROW(negativeWidth.get<CameraConfig>(), std::runtime_error);
+}
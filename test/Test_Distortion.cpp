@@ -0,0 +1,71 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "distortion.h"
+
+using namespace gtsam;
+
+namespace {
+const Cal3_S2 kK(900, 900, 0, 640, 400);
+const DistortionCoefficients kDistortion{
+    .k1 = -0.3, .k2 = 0.1, .p1 = 0.001, .p2 = -0.0005, .k3 = -0.01};
+} // namespace
+
+TEST(DistortionTest, IterativeRoundTrips) {
+  for (double u = 0; u <= 1280; u += 37) {
+    for (double v = 0; v <= 800; v += 29) {
+      const Point2 pixel{u, v};
+      const Point2 undistorted = UndistortIterative(kK, kDistortion, pixel);
+      const Point2 back = kK.uncalibrate(kDistortion.Distort(undistorted));
+
+      EXPECT_NEAR(0, (back - pixel).norm(), 1e-4);
+    }
+  }
+}
+
+TEST(DistortionTest, LutMatchesIterative) {
+  const UndistortionLut lut(kK, kDistortion, 1280, 800, 4);
+
+  for (double u = 0; u <= 1280; u += 3.7) {
+    for (double v = 0; v <= 800; v += 2.9) {
+      const Point2 pixel{u, v};
+      const auto fromLut = lut.Lookup(pixel);
+      ASSERT_TRUE(fromLut.has_value());
+
+      // compare in pixels. The default 4px grid is good to 0.01px
+      const Point2 err =
+          (*fromLut - UndistortIterative(kK, kDistortion, pixel)) * kK.fx();
+      EXPECT_LT(err.norm(), 0.01);
+    }
+  }
+}
+
+TEST(DistortionTest, LutRejectsOutsideImage) {
+  const UndistortionLut lut(kK, kDistortion, 1280, 800, 4);
+
+  EXPECT_FALSE(lut.Lookup(Point2{-1, 10}).has_value());
+  EXPECT_FALSE(lut.Lookup(Point2{10, 5000}).has_value());
+}
@@ -0,0 +1,64 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "TagModel.h"
+#include "ekf_localizer.h"
+#include "model_registry.h"
+#include "tag_fixtures.h"
+
+using namespace gtsam;
+
+TEST(EkfLocalizerTest, VisionPullsTowardsTruth) {
+  ModelRegistry registry;
+  const SharedNoiseModel &odomNoise = registry.InternNoise(
+      (Vector(6) << 0.01, 0.01, 0.01, 0.01, 0.01, 0.01).finished());
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+
+  const TagModel model{OneTagLayout()};
+  EkfLocalizer ekf;
+  ekf.SetTagLayout(OneTagLayout());
+
+  // We think we're off to the side a bit
+  const Pose3 truth{};
+  ekf.Reset(Pose3{Rot3{}, Point3{0.3, -0.2, 0}},
+            noiseModel::Isotropic::Sigma(6, 0.5), 0);
+
+  for (uint64_t t = 20 * 1000; t <= 400 * 1000; t += 20 * 1000) {
+    ekf.AddOdometry(OdometryObservation{t, Pose3{}, &odomNoise});
+    // Frames show up 40ms late
+    if (t >= 40 * 1000) {
+      ekf.AddTagObservation(
+          Observe(model, 1, truth, t - 40 * 1000, cameraNoise));
+    }
+    ekf.Optimize();
+  }
+
+  EXPECT_GT(ekf.GetLastVisionFactorCount(), 0u);
+  EXPECT_LT(ekf.GetLatestWorldToBody().translation().norm(), 0.05);
+  EXPECT_EQ(ekf.GetLastOdomTime(), 400u * 1000);
+  EXPECT_FALSE(ekf.GetPoseHistory().empty());
+}
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <gtsam/base/TestableAssertions.h>
+
+#include <cmath>
+
+#include "input_queue.h"
+
+using namespace gtsam;
+
+TEST(InputQueueTest, DropOldestKeepsNewest) {
+  std::vector<int> batch{1, 2, 3, 4, 5};
+  EXPECT_EQ(2u, DropOldest(batch, 3));
+  EXPECT_EQ((std::vector<int>{3, 4, 5}), batch);
+
+  // Under depth, or unbounded, nothing goes
+  EXPECT_EQ(0u, DropOldest(batch, 3));
+  EXPECT_EQ(0u, DropOldest(batch, 0));
+  EXPECT_EQ(3u, batch.size());
+}
+
+TEST(InputQueueTest, CoalesceKeepsAllTheMotion) {
+  ModelRegistry registry;
+  const SharedNoiseModel &noise =
+      registry.InternNoise((Vector(6) << 1, 1, 1, 2, 2, 2).finished());
+
+  std::vector<OdometryObservation> batch;
+  std::vector<Pose3> pieces;
+  Pose3 total;
+  for (uint64_t i = 0; i < 6; i++) {
+    const Pose3 delta{Rot3::Ypr(0.1 * i, 0.02, -0.01),
+                      Point3{0.5, 0.1 * i, 0}};
+    total = total * delta;
+    pieces.push_back(delta);
+    batch.push_back({1000 * (i + 1), delta, &noise});
+  }
+
+  EXPECT_EQ(3u, CoalesceOdometry(batch, 3, registry));
+  ASSERT_EQ(3u, batch.size());
+
+  // The first four became one, ending where the fourth did
+  EXPECT_EQ(4000u, batch[0].timeUs);
+  EXPECT_EQ(5000u, batch[1].timeUs);
+  EXPECT_EQ(6000u, batch[2].timeUs);
+  EXPECT_TRUE(assert_equal(
+      total, batch[0].poseDelta * batch[1].poseDelta * batch[2].poseDelta,
+      1e-9));
+
+  // Four pieces' covariance, each moved into the merged delta's end frame by
+  // the motion after it. Untouched ones keep theirs
+  Matrix6 expected = Matrix6::Zero();
+  for (size_t i = 0; i < 4; i++) {
+    Pose3 after;
+    for (size_t j = i + 1; j < 4; j++) {
+      after = after * pieces[j];
+    }
+    const Matrix6 J = after.inverse().AdjointMap();
+    expected += J * CovarianceOf(noise) * J.transpose();
+  }
+  EXPECT_TRUE(assert_equal(Matrix(expected),
+                           Matrix(CovarianceOf(*batch[0].odometryNoise)),
+                           1e-9));
+  // Turning mixes rotation noise into translation, off the diagonal too
+  EXPECT_GT(std::abs(expected(1, 5)), 1);
+  EXPECT_EQ(&noise, batch[1].odometryNoise);
+}
+
+TEST(InputQueueTest, CoalesceUnderDepthDoesNothing) {
+  ModelRegistry registry;
+  const SharedNoiseModel &noise = registry.InternNoise(Vector6::Ones());
+
+  std::vector<OdometryObservation> batch{{1000, Pose3{}, &noise},
+                                         {2000, Pose3{}, &noise}};
+  EXPECT_EQ(0u, CoalesceOdometry(batch, 2, registry));
+  EXPECT_EQ(0u, CoalesceOdometry(batch, 0, registry));
+  EXPECT_EQ(2u, batch.size());
+}
+
+TEST(InputQueueTest, PollStorageHasHeadroom) {
+  EXPECT_EQ(100u, PollStorageFor(20));
+  EXPECT_EQ(1000u, PollStorageFor(500));
+  // Unbounded shouldn't get less than a bounded queue would
+  EXPECT_EQ(kUnboundedPollStorage, PollStorageFor(0));
+  EXPECT_EQ(kUnboundedPollStorage, PollStorageFor(-1));
+  EXPECT_GT(PollStorageFor(0), PollStorageFor(1000));
+}
@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "latency_tracker.h"
+
+namespace {
+CameraVisionObservation Tag(uint64_t captureUs, uint64_t readUs) {
+  CameraVisionObservation obs{};
+  obs.timeUs = captureUs;
+  obs.readUs = readUs;
+  return obs;
+}
+} // namespace
+
+TEST(LatencyTrackerTest, Percentiles) {
+  RollingPercentiles samples(100);
+  EXPECT_EQ(0, samples.Percentile(0.5));
+
+  for (int i = 100; i >= 1; i--) {
+    samples.Add(i);
+  }
+  EXPECT_EQ(50, samples.Percentile(0.5));
+  EXPECT_EQ(99, samples.Percentile(0.99));
+  EXPECT_EQ(1, samples.Percentile(0));
+  EXPECT_EQ(100, samples.Percentile(1));
+
+  // Window is full, so these push out 100..51
+  for (int i = 0; i < 50; i++) {
+    samples.Add(0);
+  }
+  EXPECT_EQ(100u, samples.Size());
+  EXPECT_EQ(0, samples.Percentile(0.5));
+  EXPECT_EQ(50, samples.Percentile(1));
+}
+
+TEST(LatencyTrackerTest, DataAge) {
+  LatencyTracker latency(2);
+
+  // Nothing in yet, nothing to report
+  latency.Published(1000);
+  EXPECT_EQ(0, latency.OdomAge().p99Ms);
+  EXPECT_EQ(0, latency.VisionAge().p99Ms);
+
+  latency.AddOdometry(OdometryObservation{10'000, {}, nullptr, 12'000});
+  latency.AddOdometry(OdometryObservation{20'000, {}, nullptr, 21'000});
+  // Late odometry doesn't make us any fresher
+  latency.AddOdometry(OdometryObservation{15'000, {}, nullptr, 25'000});
+
+  // Two tags from one frame, plus a frame from the other camera
+  latency.AddVision({{Tag(5'000, 8'000), Tag(5'000, 8'000)},
+                     {Tag(11'000, 13'000)}});
+  latency.Published(30'000);
+
+  EXPECT_DOUBLE_EQ(10, latency.OdomAge().p50Ms);
+  EXPECT_DOUBLE_EQ(9, latency.OdomQueueDelay().p50Ms);
+  EXPECT_DOUBLE_EQ(19, latency.VisionAge().p50Ms);
+  EXPECT_DOUBLE_EQ(25, latency.CameraLatency(0).p50Ms);
+  EXPECT_DOUBLE_EQ(22, latency.CameraQueueDelay(0).p50Ms);
+  EXPECT_DOUBLE_EQ(19, latency.CameraLatency(1).p50Ms);
+
+  // No new vision, so its age keeps growing but the per camera latency
+  // doesn't get another sample
+  latency.Published(40'000);
+  EXPECT_DOUBLE_EQ(29, latency.VisionAge().p99Ms);
+  EXPECT_DOUBLE_EQ(25, latency.CameraLatency(0).p99Ms);
+}
+
+TEST(LatencyTrackerTest, HoldsAWindowWhileNotPublishing) {
+  // Say the runner isn't ready for a while, so frames pile up unpublished
+  LatencyTracker latency(1, 4);
+  for (uint64_t k = 1; k <= 100; k++) {
+    latency.AddVision({{Tag(k * 1'000, k * 1'000 + 500)}});
+  }
+  latency.Published(110'000);
+
+  // Only the newest 4 were held, same as the percentiles would keep anyway
+  EXPECT_DOUBLE_EQ(11, latency.CameraLatency(0).p50Ms);
+  EXPECT_DOUBLE_EQ(13, latency.CameraLatency(0).p99Ms);
+  EXPECT_DOUBLE_EQ(12.5, latency.CameraQueueDelay(0).p99Ms);
+}
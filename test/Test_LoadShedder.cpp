@@ -0,0 +1,149 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "TagModel.h"
+#include "load_shedder.h"
+#include "localizer.h"
+#include "model_registry.h"
+#include "tag_fixtures.h"
+
+using namespace gtsam;
+
+namespace {
+// 1 and 2 are close, side by side. 3 is far away, behind 1
+frc::AprilTagFieldLayout Layout() {
+  return frc::AprilTagFieldLayout{{TagFacingOrigin(1, 3, 0),
+                                   TagFacingOrigin(2, 3, 2),
+                                   TagFacingOrigin(3, 9, 0)},
+                                  units::meter_t{16},
+                                  units::meter_t{8}};
+}
+
+// Everything here is seen from the origin
+CameraVisionObservation Observe(const TagModel &model, int tagID,
+                                const SharedNoiseModel &noise) {
+  return ::Observe(model, tagID, Pose3{}, 0, noise);
+}
+
+std::vector<int> KeptIds(
+    const std::vector<std::vector<CameraVisionObservation>> &perCamera) {
+  std::vector<int> ret;
+  for (const auto &camera : perCamera) {
+    for (const auto &obs : camera) {
+      ret.push_back(obs.tagID);
+    }
+  }
+  return ret;
+}
+} // namespace
+
+TEST(LoadShedderTest, KeepsTheClosestTag) {
+  ModelRegistry registry;
+  const SharedNoiseModel &noise = registry.InternNoise(Vector2{0.002, 0.002});
+  const TagModel model{Layout()};
+
+  std::vector<std::vector<CameraVisionObservation>> perCamera{
+      {Observe(model, 3, noise), Observe(model, 1, noise)}};
+  const SheddingStats stats = LoadShedder::Select(
+      perCamera, model, Pose3{}, Matrix6::Identity() * 0.1, 1);
+
+  EXPECT_EQ(1u, stats.kept);
+  EXPECT_EQ(1u, stats.dropped);
+  EXPECT_EQ(std::vector<int>{1}, KeptIds(perCamera));
+}
+
+TEST(LoadShedderTest, PrefersNewInformation) {
+  ModelRegistry registry;
+  const SharedNoiseModel &noise = registry.InternNoise(Vector2{0.002, 0.002});
+  const TagModel model{Layout()};
+
+  // Tag 1 twice (two cameras on the same mount), and tag 2 off to the side.
+  // The second copy of tag 1 tells us nothing the first didn't
+  std::vector<std::vector<CameraVisionObservation>> perCamera{
+      {Observe(model, 1, noise)},
+      {Observe(model, 1, noise), Observe(model, 2, noise)}};
+  const SheddingStats stats = LoadShedder::Select(
+      perCamera, model, Pose3{}, Matrix6::Identity() * 0.1, 2);
+
+  EXPECT_EQ(2u, stats.kept);
+  EXPECT_EQ(1u, stats.dropped);
+  std::vector<int> ids = KeptIds(perCamera);
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ((std::vector<int>{1, 2}), ids);
+}
+
+TEST(LoadShedderTest, UnscoredTagsGetLeftovers) {
+  ModelRegistry registry;
+  const SharedNoiseModel &noise = registry.InternNoise(Vector2{0.002, 0.002});
+  const TagModel model{Layout()};
+
+  CameraVisionObservation unknown = Observe(model, 1, noise);
+  unknown.tagID = 42;
+  std::vector<std::vector<CameraVisionObservation>> perCamera{
+      {unknown, Observe(model, 3, noise), Observe(model, 1, noise)}};
+  LoadShedder::Select(perCamera, model, Pose3{}, Matrix6::Identity() * 0.1,
+                      2);
+
+  // Order within a camera is kept
+  EXPECT_EQ((std::vector<int>{3, 1}), KeptIds(perCamera));
+}
+
+TEST(LoadShedderTest, OnlyShedsOverBudget) {
+  ModelRegistry registry;
+  const SharedNoiseModel &noise = registry.InternNoise(Vector2{0.002, 0.002});
+  const TagModel model{Layout()};
+
+  const SharedNoiseModel &odometryNoise =
+      registry.InternNoise(Vector6::Constant(0.01));
+
+  Localizer localizer;
+  localizer.SetTagLayout(Layout());
+  localizer.Reset(Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1), 1000);
+  localizer.AddOdometry(
+      OdometryObservation{100 * 1000, Pose3{}, &odometryNoise});
+  localizer.Optimize();
+
+  const std::vector<std::vector<CameraVisionObservation>> all{
+      {Observe(model, 1, noise), Observe(model, 2, noise),
+       Observe(model, 3, noise)}};
+
+  // 3 pending is within budget, so nothing goes
+  auto perCamera = all;
+  SheddingStats stats =
+      LoadShedder{LoadSheddingConfig{.maxTags = 1, .pendingBudget = 3}}.Apply(
+          perCamera, model, localizer);
+  EXPECT_EQ(3u, stats.kept);
+  EXPECT_EQ(0u, stats.dropped);
+
+  perCamera = all;
+  stats = LoadShedder{LoadSheddingConfig{.maxTags = 1}}.Apply(perCamera,
+                                                              model, localizer);
+  EXPECT_EQ(1u, stats.kept);
+  EXPECT_EQ(2u, stats.dropped);
+}
@@ -24,9 +24,28 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "localizer.h"
+#include "model_registry.h"
+#include "tag_fixtures.h"
 
 using namespace gtsam;
+using symbol_shorthand::X;
+
+namespace {
+// Reset, then add the same odometry step every periodUs up to untilUs,
+// optimizing after each one like the node does
+void Drive(Localizer &localizer, const Pose3 &step,
+           const SharedNoiseModel &noise, uint64_t untilUs,
+           uint64_t periodUs = 100 * 1000) {
+  localizer.Reset(Pose3(), noiseModel::Isotropic::Sigma(6, 0.1), 5 * 1000);
+  for (uint64_t t = periodUs; t <= untilUs; t += periodUs) {
+    localizer.AddOdometry(OdometryObservation{t, step, &noise});
+    localizer.Optimize();
+  }
+}
+} // namespace
 
 TEST(LocalizerTest, LatencyCompensate) {
   /*
@@ -41,9 +60,12 @@ TEST(LocalizerTest, LatencyCompensate) {
   // Cal3_S2 K(90, 960, 720);
   Cal3_S2 K(1000, 1000, 0, 960 / 2, 720 / 2);
 
+  ModelRegistry registry;
+
   // setup noise using fake numbers
-  // Pixel noise, in u,v coordinates
-  auto measurementNoise = noiseModel::Isotropic::Sigma(2, 2.0);
+  // Pixel noise, in u,v coordinates, scaled into normalized image coordinates
+  const SharedNoiseModel &measurementNoise =
+      registry.InternNoise(Vector2{2.0 / K.fx(), 2.0 / K.fy()});
 
   // Noise on the prior factor we use to anchor the first pose.
   // TODO: If we initialize with enough measurements, we might be able to
@@ -55,36 +77,34 @@ TEST(LocalizerTest, LatencyCompensate) {
   // odometry noise
   Vector6 odomSigma;
   odomSigma << Vector3::Constant(0.001), Vector3::Constant(0.05);
-  auto odometryNoise = noiseModel::Diagonal::Sigmas(odomSigma);
-
-  Cal3_S2_ cal(K);
+  const SharedNoiseModel &odometryNoise = registry.InternNoise(odomSigma);
 
   auto localizer = Localizer();
 
   localizer.Reset(Pose3(), posePriorNoise, 5 * 1000);
   localizer.AddOdometry(OdometryObservation{
-      100 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, odometryNoise});
+      100 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, &odometryNoise});
   localizer.AddOdometry(OdometryObservation{
-      200 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, odometryNoise});
+      200 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, &odometryNoise});
   localizer.AddOdometry(OdometryObservation{
-      300 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, odometryNoise});
+      300 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, &odometryNoise});
   localizer.AddOdometry(OdometryObservation{
-      400 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, odometryNoise});
+      400 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, &odometryNoise});
   localizer.Optimize();
   auto pose = localizer.GetLatestWorldToBody();
   pose.print("Pose: ");
 
+  // Observations carry normalized corners, like CameraListener makes
   CameraVisionObservation obs{240000,
                               8,
                               {
-                                  {414, 166},
-                                  {457, 165},
-                                  {457, 122},
-                                  {412, 122},
+                                  K.calibrate(Point2{414, 166}),
+                                  K.calibrate(Point2{457, 165}),
+                                  K.calibrate(Point2{457, 122}),
+                                  K.calibrate(Point2{412, 122}),
                               },
-                              cal,
                               Pose3(),
-                              measurementNoise};
+                              &measurementNoise};
 
   // add vision to within isam's history
   localizer.AddTagObservation(obs);
@@ -95,22 +115,365 @@ TEST(LocalizerTest, LatencyCompensate) {
 
   // add but don't optimize
   localizer.AddOdometry(OdometryObservation{
-      500 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, odometryNoise});
+      500 * 1000, Pose3{Rot3{}, Point3{1, 0, 0}}, &odometryNoise});
 
   obs = {460000,
          8,
          {
-             {414, 166},
-             {457, 165},
-             {457, 122},
-             {412, 122},
+             K.calibrate(Point2{414, 166}),
+             K.calibrate(Point2{457, 165}),
+             K.calibrate(Point2{457, 122}),
+             K.calibrate(Point2{412, 122}),
          },
-         cal,
          Pose3(),
-         measurementNoise};
+         &measurementNoise};
 
   localizer.AddTagObservation(obs);
   localizer.Optimize();
   pose = localizer.GetLatestWorldToBody();
   localizer.Print();
 }
+
+TEST(LocalizerTest, GyroPreintegration) {
+  ModelRegistry registry;
+
+  Vector6 sigmas;
+  sigmas << Vector3::Constant(0.01), Vector3::Constant(0.01);
+  auto posePriorNoise = noiseModel::Diagonal::Sigmas(sigmas);
+
+  // Odometry that's pretty unsure about rotation, and thinks we aren't turning
+  Vector6 odomSigma;
+  odomSigma << Vector3::Constant(1.0), Vector3::Constant(0.01);
+  const SharedNoiseModel &odometryNoise = registry.InternNoise(odomSigma);
+
+  auto localizer = Localizer();
+  localizer.EnableImu(ImuConfig{});
+  localizer.Reset(Pose3(), posePriorNoise, 5 * 1000);
+
+  // Spin at 1 rad/s for 0.4s, gyro at 1khz
+  constexpr double yawRate = 1.0;
+  for (uint64_t t = 6 * 1000; t <= 405 * 1000; t += 1000) {
+    localizer.AddImu(ImuObservation{t, Vector3{0, 0, yawRate}, Vector3{}});
+  }
+  for (uint64_t t = 100 * 1000; t <= 400 * 1000; t += 100 * 1000) {
+    localizer.AddOdometry(OdometryObservation{t, Pose3{}, &odometryNoise});
+  }
+  localizer.Optimize();
+
+  // Gyro should win out over the odometry; integrated from just before our
+  // prior at 5ms up to the last state at 400ms
+  const double yaw = localizer.GetLatestWorldToBody().rotation().yaw();
+  EXPECT_NEAR(yaw, yawRate * (0.4 - 0.005), 0.01);
+  EXPECT_EQ(0u, localizer.GetDroppedImuCount());
+}
+
+TEST(LocalizerTest, GyroQueueIsBounded) {
+  ModelRegistry registry;
+  const SharedNoiseModel &odometryNoise =
+      registry.InternNoise(Vector6::Constant(0.01));
+
+  auto localizer = Localizer();
+  localizer.EnableImu(ImuConfig{.queueDepth = 10});
+  localizer.Reset(Pose3(), noiseModel::Isotropic::Sigma(6, 0.1), 5 * 1000);
+
+  // Twice as many as we hold before any odometry closes an interval
+  for (uint64_t t = 6 * 1000; t < 26 * 1000; t += 1000) {
+    localizer.AddImu(ImuObservation{t, Vector3{0, 0, 1}, Vector3{}});
+  }
+  EXPECT_EQ(10u, localizer.GetDroppedImuCount());
+
+  localizer.AddOdometry(
+      OdometryObservation{50 * 1000, Pose3{}, &odometryNoise});
+  // and one from an interval that's already been integrated
+  localizer.AddImu(ImuObservation{40 * 1000, Vector3{0, 0, 1}, Vector3{}});
+  localizer.AddOdometry(
+      OdometryObservation{100 * 1000, Pose3{}, &odometryNoise});
+  EXPECT_EQ(11u, localizer.GetDroppedImuCount());
+}
+
+TEST(LocalizerTest, BackendsAgree) {
+  ModelRegistry registry;
+
+  Vector6 odomSigma;
+  odomSigma << Vector3::Constant(0.01), Vector3::Constant(0.05);
+  const SharedNoiseModel &odometryNoise = registry.InternNoise(odomSigma);
+
+  WorkerPool pool{2};
+  Localizer isam{{.smoother = "isam2"}};
+  Localizer batch{{.smoother = "batch"}};
+  // Long enough that states age out of the concurrent filter. With a pool
+  // its smoother passes run in the background
+  Localizer concurrent{{.smoother = "concurrent"}};
+  Localizer pooled{{.smoother = "concurrent", .pool = &pool}};
+
+  for (Localizer *localizer : {&isam, &batch, &concurrent, &pooled}) {
+    Drive(*localizer, Pose3{Rot3::Yaw(0.1), Point3{1, 0, 0}}, odometryNoise,
+          1000 * 1000);
+  }
+
+  EXPECT_TRUE(isam.GetLatestWorldToBody().equals(batch.GetLatestWorldToBody(),
+                                                 1e-6));
+  EXPECT_TRUE(gtsam::assert_equal(isam.GetLatestMarginals(),
+                                  batch.GetLatestMarginals(), 1e-6));
+  EXPECT_TRUE(isam.GetLatestWorldToBody().equals(
+      concurrent.GetLatestWorldToBody(), 1e-6));
+  EXPECT_TRUE(isam.GetLatestWorldToBody().equals(
+      pooled.GetLatestWorldToBody(), 1e-6));
+
+  EXPECT_THROW(Localizer{{.smoother = "nope"}}, std::runtime_error);
+}
+
+TEST(LocalizerTest, ConcurrentSmootherKeepsAWindow) {
+  ModelRegistry registry;
+
+  Vector6 odomSigma;
+  odomSigma << Vector3::Constant(0.01), Vector3::Constant(0.05);
+  const SharedNoiseModel &odometryNoise = registry.InternNoise(odomSigma);
+
+  // A 1s lag over 3s of states, so the smoother marginalizes as it goes
+  Localizer isam{{.lagUs = 1e6}};
+  Localizer concurrent{{.smoother = "concurrent", .lagUs = 1e6}};
+
+  for (Localizer *localizer : {&isam, &concurrent}) {
+    Drive(*localizer, Pose3{Rot3::Yaw(0.1), Point3{1, 0, 0}}, odometryNoise,
+          3000 * 1000, 50 * 1000);
+  }
+
+  EXPECT_TRUE(isam.GetLatestWorldToBody().equals(
+      concurrent.GetLatestWorldToBody(), 1e-6));
+}
+
+TEST(LocalizerTest, Isam2OrderingsAgree) {
+  ModelRegistry registry;
+
+  Vector6 odomSigma;
+  odomSigma << Vector3::Constant(0.01), Vector3::Constant(0.05);
+  const SharedNoiseModel &odometryNoise = registry.InternNoise(odomSigma);
+
+  Localizer colamd;
+  Localizer qr{{.isam2 = {.factorization = "qr"}}};
+  Localizer constrained{{.isam2 = {.ordering = "constrained"}}};
+  Localizer sparsified{{.isam2 = {.sparsifyMarginals = true}}};
+
+  // Long enough that states get marginalized out of the 5s window
+  for (Localizer *localizer : {&colamd, &qr, &constrained, &sparsified}) {
+    Drive(*localizer, Pose3{Rot3::Yaw(0.1), Point3{1, 0, 0}}, odometryNoise,
+          8000 * 1000);
+  }
+
+  EXPECT_TRUE(colamd.GetLatestWorldToBody().equals(qr.GetLatestWorldToBody(),
+                                                   1e-6));
+  EXPECT_TRUE(colamd.GetLatestWorldToBody().equals(
+      constrained.GetLatestWorldToBody(), 1e-6));
+  EXPECT_TRUE(gtsam::assert_equal(colamd.GetLatestMarginals(),
+                                  constrained.GetLatestMarginals(), 1e-6));
+  // Odometry alone only ever leaves a marginal on one state, so there's
+  // nothing to approximate
+  EXPECT_TRUE(colamd.GetLatestWorldToBody().equals(
+      sparsified.GetLatestWorldToBody(), 1e-6));
+
+  EXPECT_THROW(Localizer{{.isam2 = {.ordering = "nope"}}}, std::runtime_error);
+}
+
+TEST(LocalizerTest, ConstrainedOrderingKeepsNewestAtRoot) {
+  ModelRegistry registry;
+  const SharedNoiseModel &odometryNoise =
+      registry.InternNoise(Vector6::Constant(0.01));
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+  const TagModel model{TwoTagLayout()};
+
+  Localizer localizer{{.isam2 = {.ordering = "constrained"}}};
+  localizer.SetTagLayout(TwoTagLayout());
+  localizer.Reset(Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1), 5 * 1000);
+
+  // Vision attaching 3s back, deep in the 5s window, for long enough that
+  // states are being marginalized too
+  constexpr uint64_t kVisionLagUs = 3000 * 1000;
+  for (uint64_t t = 100 * 1000; t <= 8000 * 1000; t += 100 * 1000) {
+    localizer.AddOdometry(OdometryObservation{t, Pose3{}, &odometryNoise});
+    if (t > kVisionLagUs) {
+      localizer.AddTagObservation(
+          Observe(model, 1, Pose3{}, t - kVisionLagUs, cameraNoise));
+    }
+    localizer.Optimize();
+
+    const ISAM2 *isam = localizer.GetSmoother().GetISAM2();
+    ASSERT_NE(nullptr, isam);
+    const bool newestAtRoot =
+        std::any_of(isam->roots().begin(), isam->roots().end(),
+                    [t](const ISAM2::sharedClique &root) {
+                      const auto &conditional = root->conditional();
+                      return std::find(conditional->beginFrontals(),
+                                       conditional->endFrontals(),
+                                       X(t)) != conditional->endFrontals();
+                    });
+    EXPECT_TRUE(newestAtRoot) << "at " << t;
+  }
+}
+
+TEST(LocalizerTest, PlanarMatchesFull) {
+  ModelRegistry registry;
+
+  Vector6 odomSigma;
+  odomSigma << Vector3::Constant(0.01), Vector3::Constant(0.05);
+  const SharedNoiseModel &odometryNoise = registry.InternNoise(odomSigma);
+
+  Localizer full;
+  Localizer planar{{.planar = PlanarConfig{}}};
+  Localizer raised{{.planar = PlanarConfig{.height = 0.3}}};
+
+  for (Localizer *localizer : {&full, &planar, &raised}) {
+    Drive(*localizer, Pose3{Rot3::Yaw(0.1), Point3{1, 0.2, 0}}, odometryNoise,
+          1000 * 1000);
+  }
+
+  // Driving on the floor, the full graph never leaves it either
+  EXPECT_TRUE(full.GetLatestWorldToBody().equals(
+      planar.GetLatestWorldToBody(), 1e-6));
+  EXPECT_NEAR(raised.GetLatestWorldToBody().z(), 0.3, 1e-9);
+
+  // and yaw/x/y don't couple into roll/pitch/z, so their covariance agrees
+  const Matrix fullCov = full.GetLatestMarginals();
+  const Matrix planarCov = planar.GetLatestMarginals();
+  ASSERT_EQ(planarCov.rows(), 6);
+  EXPECT_TRUE(gtsam::assert_equal(Matrix(fullCov.block<3, 3>(2, 2)),
+                                  Matrix(planarCov.block<3, 3>(2, 2)), 1e-6));
+  EXPECT_NEAR(planarCov(5, 5), 0, 1e-12);
+}
+
+TEST(LocalizerTest, FramePoseFactors) {
+  ModelRegistry registry;
+  const SharedNoiseModel &odometryNoise =
+      registry.InternNoise(Vector6::Constant(0.01));
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+  const TagModel model{TwoTagLayout()};
+
+  Localizer corners;
+  Localizer frames{{.framePoseFactors = true}};
+
+  // Sitting still at the origin, but we think we're off to the side a bit
+  const Pose3 truth{};
+  for (Localizer *localizer : {&corners, &frames}) {
+    localizer->SetTagLayout(TwoTagLayout());
+    localizer->Reset(Pose3{Rot3{}, Point3{0.3, -0.2, 0}},
+                     noiseModel::Isotropic::Sigma(6, 0.5), 5 * 1000);
+    for (uint64_t t = 100 * 1000; t <= 1000 * 1000; t += 100 * 1000) {
+      localizer->AddOdometry(OdometryObservation{t, Pose3{}, &odometryNoise});
+      // Both tags in one frame, 40ms old
+      if (t >= 200 * 1000) {
+        localizer->AddTagObservation(
+            Observe(model, 1, truth, t - 40 * 1000, cameraNoise));
+        localizer->AddTagObservation(
+            Observe(model, 2, truth, t - 40 * 1000, cameraNoise));
+      }
+      localizer->Optimize();
+    }
+  }
+
+  // Added one at a time, each tag is its own frame
+  EXPECT_EQ(corners.GetLastVisionFactorCount(), 8u);
+  EXPECT_EQ(frames.GetLastVisionFactorCount(), 2u);
+  EXPECT_TRUE(truth.equals(corners.GetLatestWorldToBody(), 1e-2));
+  EXPECT_TRUE(truth.equals(frames.GetLatestWorldToBody(), 1e-2));
+
+  // Handed over together, they're one
+  WorkerPool pool{2};
+  frames.AddOdometry(
+      OdometryObservation{1100 * 1000, Pose3{}, &odometryNoise});
+  frames.AddTagObservations(
+      {{Observe(model, 1, truth, 1060 * 1000, cameraNoise),
+        Observe(model, 2, truth, 1060 * 1000, cameraNoise)}},
+      pool);
+  frames.Optimize();
+  EXPECT_EQ(frames.GetLastVisionFactorCount(), 1u);
+  EXPECT_TRUE(truth.equals(frames.GetLatestWorldToBody(), 1e-2));
+
+  // Anything else pushed in isn't vision
+  frames.AddOdometry(
+      OdometryObservation{1200 * 1000, Pose3{}, &odometryNoise});
+  NonlinearFactorGraph other;
+  other.addPrior(frames.GetCurrStateIdx(), truth,
+                 noiseModel::Isotropic::Sigma(6, 0.1));
+  frames.AddFactors(other);
+  frames.Optimize();
+  EXPECT_EQ(frames.GetLastVisionFactorCount(), 0u);
+}
+
+TEST(LocalizerTest, ReprojectionDiagnostics) {
+  ModelRegistry registry;
+  const SharedNoiseModel &odometryNoise =
+      registry.InternNoise(Vector6::Constant(0.01));
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+  const TagModel model{TwoTagLayout()};
+
+  Localizer on;
+  Localizer off{{.reprojectionDiagnostics = false}};
+
+  for (Localizer *localizer : {&on, &off}) {
+    localizer->SetTagLayout(TwoTagLayout());
+    localizer->Reset(Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1), 5 * 1000);
+    for (uint64_t t = 100 * 1000; t <= 1000 * 1000; t += 100 * 1000) {
+      localizer->AddOdometry(OdometryObservation{t, Pose3{}, &odometryNoise});
+      localizer->AddTagObservation(
+          Observe(model, 1, Pose3{}, t - 40 * 1000, cameraNoise));
+      localizer->Optimize();
+    }
+  }
+
+  // Every corner is still in the window
+  EXPECT_EQ(on.GetReprojectionSummary().total.corners, 10u * 4);
+  EXPECT_LT(on.GetReprojectionSummary().total.rms, 1);
+  EXPECT_EQ(off.GetReprojectionSummary().total.corners, 0u);
+}
+
+TEST(LocalizerTest, ResetMovesLastOdomTime) {
+  ModelRegistry registry;
+  const SharedNoiseModel &odometryNoise =
+      registry.InternNoise(Vector6::Constant(0.01));
+
+  Localizer localizer;
+  localizer.Reset(Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1), 5 * 1000);
+  localizer.AddOdometry(
+      OdometryObservation{100 * 1000, Pose3{}, &odometryNoise});
+  EXPECT_EQ(100u * 1000, localizer.GetLastOdomTime());
+
+  // Back to the reset state, not the odometry it replaced
+  localizer.Reset(Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1), 50 * 1000);
+  EXPECT_EQ(50u * 1000 - 1, localizer.GetLastOdomTime());
+}
+
+TEST(LocalizerTest, VisionOnAStateUsesIt) {
+  ModelRegistry registry;
+  const SharedNoiseModel &odometryNoise =
+      registry.InternNoise(Vector6::Constant(0.01));
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+  const TagModel model{TwoTagLayout()};
+
+  Localizer localizer;
+  localizer.SetTagLayout(TwoTagLayout());
+  localizer.Reset(Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1), 5 * 1000);
+  localizer.AddOdometry(
+      OdometryObservation{100 * 1000, Pose3{}, &odometryNoise});
+  // Before anything's been optimized
+  EXPECT_NO_THROW(localizer.AddTagObservation(
+      Observe(model, 1, Pose3{}, 100 * 1000, cameraNoise)));
+  localizer.Optimize();
+
+  localizer.AddOdometry(
+      OdometryObservation{200 * 1000, Pose3{}, &odometryNoise});
+  // Already in the smoother, and the newest state, not yet added
+  EXPECT_NO_THROW(localizer.AddTagObservation(
+      Observe(model, 1, Pose3{}, 100 * 1000, cameraNoise)));
+  EXPECT_NO_THROW(localizer.AddTagObservation(
+      Observe(model, 2, Pose3{}, 200 * 1000, cameraNoise)));
+  localizer.Optimize();
+
+  // Nothing interpolated in between
+  EXPECT_EQ(3u, localizer.GetSmoother().Timestamps().size());
+  // Both tags' corners
+  EXPECT_EQ(2u * 4, localizer.GetLastVisionFactorCount());
+}
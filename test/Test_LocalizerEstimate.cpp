@@ -0,0 +1,58 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <array>
+
+#include "LocalizerEstimateStruct.h"
+
+TEST(LocalizerEstimateTest, PackRoundTrip) {
+  LocalizerEstimate est{
+      frc::Pose3d{frc::Translation3d{units::meter_t{1}, units::meter_t{2},
+                                     units::meter_t{3}},
+                  frc::Rotation3d{units::radian_t{0.1}, units::radian_t{0.2},
+                                  units::radian_t{0.3}}},
+      {},
+      123456789,
+      0x7800000000001234,
+      12,
+      4.5,
+  };
+  for (size_t i = 0; i < est.covariance.size(); i++) {
+    est.covariance[i] = i * 0.5;
+  }
+
+  using S = wpi::Struct<LocalizerEstimate>;
+  std::array<uint8_t, S::GetSize()> buf{};
+  S::Pack(buf, est);
+  const LocalizerEstimate out = S::Unpack(buf);
+
+  EXPECT_EQ(est.pose, out.pose);
+  EXPECT_EQ(est.covariance, out.covariance);
+  EXPECT_EQ(est.timestampUs, out.timestampUs);
+  EXPECT_EQ(est.stateKey, out.stateKey);
+  EXPECT_EQ(est.visionFactors, out.visionFactors);
+  EXPECT_EQ(est.optimizeMs, out.optimizeMs);
+}
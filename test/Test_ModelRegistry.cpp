@@ -0,0 +1,64 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <gtsam/base/TestableAssertions.h>
+
+#include "model_registry.h"
+
+using namespace gtsam;
+
+TEST(ModelRegistryTest, InternsNoiseByValue) {
+  ModelRegistry registry;
+
+  const SharedNoiseModel &a = registry.InternNoise(Vector2::Constant(2.0));
+  const SharedNoiseModel &b = registry.InternNoise(Vector2::Constant(2.0));
+  const SharedNoiseModel &c = registry.InternNoise(Vector2::Constant(3.0));
+
+  EXPECT_EQ(&a, &b);
+  EXPECT_EQ(a.get(), b.get());
+  EXPECT_NE(&a, &c);
+  EXPECT_EQ(2u, registry.NumNoiseModels());
+}
+
+TEST(ModelRegistryTest, InternsCovarianceByValue) {
+  ModelRegistry registry;
+
+  Matrix2 cov;
+  cov << 4, 1, 1, 2;
+  const SharedNoiseModel &a = registry.InternCovariance(cov);
+  const SharedNoiseModel &b = registry.InternCovariance(cov);
+  // Diagonal ones still come back as a diagonal model
+  const SharedNoiseModel &c =
+      registry.InternCovariance(Matrix2(Vector2(4, 9).asDiagonal()));
+
+  EXPECT_EQ(&a, &b);
+  EXPECT_NE(&a, &c);
+  EXPECT_TRUE(gtsam::assert_equal(
+      Matrix(cov),
+      std::dynamic_pointer_cast<noiseModel::Gaussian>(a)->covariance(), 1e-9));
+  EXPECT_TRUE(std::dynamic_pointer_cast<noiseModel::Diagonal>(c));
+  EXPECT_TRUE(gtsam::assert_equal(Vector2(2, 3), c->sigmas(), 1e-9));
+  EXPECT_EQ(2u, registry.NumNoiseModels());
+}
@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "TagModel.h"
+#include "model_registry.h"
+#include "pnp.h"
+#include "tag_fixtures.h"
+
+using namespace gtsam;
+
+TEST(PnpTest, HomographyRecoversCameraToTag) {
+  const Pose3 cameraTtag{Rot3::Ypr(1.4, 0.1, -1.6), Point3{0.2, -0.1, 3}};
+
+  std::vector<Point2> corners;
+  for (const Point3 &tagPcorner : TagModel::TagToCorners()) {
+    const Point3 camPcorner = cameraTtag.transformFrom(tagPcorner);
+    corners.emplace_back(camPcorner.x() / camPcorner.z(),
+                         camPcorner.y() / camPcorner.z());
+  }
+
+  const auto solved = pnp::CameraToTagFromHomography(corners);
+  ASSERT_TRUE(solved);
+  EXPECT_TRUE(assert_equal(cameraTtag, *solved, 1e-6));
+}
+
+TEST(PnpTest, SolvesFrameFromTags) {
+  ModelRegistry registry;
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+  const TagModel model{TwoTagLayout()};
+
+  const Pose3 truth{Rot3::Yaw(0.1), Point3{1, 0.3, 0}};
+
+  // One tag is enough
+  const auto single =
+      pnp::SolveFrame({Observe(model, 1, truth, 1000, cameraNoise)}, model);
+  ASSERT_TRUE(single);
+  EXPECT_EQ(single->time, 1000u);
+  EXPECT_TRUE(assert_equal(truth, single->value.pose, 1e-4));
+
+  // Two pin it down better
+  const auto both =
+      pnp::SolveFrame({Observe(model, 1, truth, 1000, cameraNoise),
+                       Observe(model, 2, truth, 1000, cameraNoise)},
+                      model);
+  ASSERT_TRUE(both);
+  EXPECT_TRUE(assert_equal(truth, both->value.pose, 1e-4));
+  const auto singleSigmas = single->value.noise->sigmas();
+  const auto bothSigmas = both->value.noise->sigmas();
+  EXPECT_LT(bothSigmas.norm(), singleSigmas.norm());
+}
+
+TEST(PnpTest, RejectsUnknownAndInconsistentFrames) {
+  ModelRegistry registry;
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+  const TagModel model{TwoTagLayout()};
+  const Pose3 truth{};
+
+  // Tag 1's corners, but we claim they're tag 3
+  auto unknown = Observe(model, 1, truth, 0, cameraNoise);
+  unknown.tagID = 3;
+  EXPECT_FALSE(pnp::SolveFrame({unknown}, model));
+
+  // Two tags that can't both be right
+  EXPECT_FALSE(pnp::SolveFrame(
+      {Observe(model, 1, truth, 0, cameraNoise),
+       Observe(model, 2, Pose3{Rot3{}, Point3{0, 0.5, 0}}, 0, cameraNoise)},
+      model));
+}
+
+TEST(PnpTest, BestFramePicksMostTags) {
+  ModelRegistry registry;
+  const SharedNoiseModel &cameraNoise =
+      registry.InternNoise(Vector2::Constant(0.002));
+  const TagModel model{TwoTagLayout()};
+
+  const Pose3 early{};
+  const Pose3 late{Rot3{}, Point3{0.5, 0, 0}};
+  const std::vector<std::vector<CameraVisionObservation>> perCamera{
+      {Observe(model, 1, early, 1000, cameraNoise),
+       Observe(model, 2, early, 1000, cameraNoise)},
+      {Observe(model, 1, late, 2000, cameraNoise)},
+  };
+
+  const auto solve = pnp::SolveBestFrame(perCamera, model);
+  ASSERT_TRUE(solve);
+  EXPECT_EQ(solve->time, 1000u);
+  EXPECT_TRUE(assert_equal(early, solve->value.pose, 1e-4));
+}
@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "realtime.h"
+
+#ifdef __linux__
+#include <sched.h>
+
+TEST(RealtimeTest, PinsThread) {
+  // Any core we're allowed on -- under a container or taskset that may not
+  // include 0
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  int target = 0;
+  while (target < CPU_SETSIZE && !CPU_ISSET(target, &allowed)) {
+    target++;
+  }
+  ASSERT_LT(target, CPU_SETSIZE);
+
+  // On its own thread, so the rest of the tests aren't stuck on one core
+  bool ok = false;
+  int cpu = -1;
+  std::thread([&] {
+    ok = ConfigureCurrentThread({target}, RealtimeConfig{});
+    cpu = sched_getcpu();
+  }).join();
+
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(target, cpu);
+}
+
+TEST(RealtimeTest, BadCpuFailsSoftly) {
+  bool ok = true;
+  std::thread([&] { ok = ConfigureCurrentThread({100000}, RealtimeConfig{}); })
+      .join();
+
+  EXPECT_FALSE(ok);
+}
+#endif
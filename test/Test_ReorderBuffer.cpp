@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "reorder_buffer.h"
+
+namespace {
+struct Stamped {
+  uint64_t timeUs;
+  int id;
+};
+} // namespace
+
+TEST(ReorderBufferTest, ReleasesSortedUpToCutoff) {
+  ReorderBuffer<Stamped> buffer;
+  buffer.Push({30, 0});
+  buffer.Push({10, 1});
+  buffer.Push({50, 2});
+  buffer.Push({20, 3});
+
+  auto out = buffer.Release(30);
+  ASSERT_EQ(3u, out.size());
+  EXPECT_EQ(10u, out[0].timeUs);
+  EXPECT_EQ(20u, out[1].timeUs);
+  EXPECT_EQ(30u, out[2].timeUs);
+
+  // 50 is still inside the window
+  EXPECT_EQ(1u, buffer.Size());
+  EXPECT_EQ(0u, buffer.Stragglers());
+}
+
+TEST(ReorderBufferTest, CountsStragglers) {
+  ReorderBuffer<Stamped> buffer;
+  buffer.Push({100, 0});
+  EXPECT_EQ(1u, buffer.Release(100).size());
+
+  // shows up after its window closed, still comes out with the next batch
+  buffer.Push({120, 1});
+  buffer.Push({90, 2});
+  auto out = buffer.Release(150);
+  ASSERT_EQ(2u, out.size());
+  EXPECT_EQ(90u, out[0].timeUs);
+  EXPECT_EQ(1u, buffer.Stragglers());
+}
+
+TEST(ReorderBufferTest, DropsThroughReset) {
+  ReorderBuffer<Stamped> buffer;
+  buffer.Push({10, 0});
+  buffer.Push({20, 1});
+  buffer.Push({30, 2});
+
+  buffer.DropThrough(20);
+  auto out = buffer.Release(100);
+  ASSERT_EQ(1u, out.size());
+  EXPECT_EQ(30u, out[0].timeUs);
+}
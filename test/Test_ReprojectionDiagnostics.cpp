@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <optional>
+#include <vector>
+
+#include "reprojection_diagnostics.h"
+
+using namespace gtsam;
+
+namespace {
+// Camera looking down the robot's +x
+const Pose3 kRobotTcamera{
+    Rot3{(Matrix3() << 0, 0, 1, -1, 0, 0, 0, -1, 0).finished()}, Point3{}};
+const std::vector<Point3> kWorldPcorners{
+    {5, 0.1, 1.1}, {5, -0.1, 1.1}, {5, -0.1, 0.9}, {5, 0.1, 0.9}};
+const Pose3 kTruth{Rot3{}, Point3{0, 0, 1}};
+
+std::vector<Point2> Project(const Pose3 &worldTrobot) {
+  std::vector<Point2> corners;
+  for (const auto &worldPcorner : kWorldPcorners) {
+    const Point3 cameraP =
+        (worldTrobot * kRobotTcamera).transformTo(worldPcorner);
+    corners.emplace_back(cameraP.x() / cameraP.z(), cameraP.y() / cameraP.z());
+  }
+  return corners;
+}
+} // namespace
+
+TEST(ReprojectionDiagnosticsTest, FindsOutliers) {
+  ReprojectionDiagnostics diagnostics;
+  for (Key key = 1; key <= 100; key++) {
+    auto corners = Project(kTruth);
+    // 5 sigma off on one corner
+    if (key % 10 == 0) {
+      corners[0].x() += 0.01;
+    }
+    diagnostics.Add(key, key % 2, 7 + key % 3, kRobotTcamera, kWorldPcorners,
+                    corners, Vector2{0.002, 0.002});
+  }
+
+  // Keeps 50..100
+  diagnostics.Prune(50);
+  EXPECT_EQ(diagnostics.NumObservations(), 51u);
+
+  // And a state the smoother doesn't have gets skipped
+  const auto summary =
+      diagnostics.Evaluate([](Key key) -> std::optional<Pose3> {
+        if (key == 77) {
+          return std::nullopt;
+        }
+        return kTruth;
+      });
+
+  EXPECT_EQ(summary.total.corners, 200u);
+  EXPECT_EQ(summary.total.outliers, 6u);
+  EXPECT_NEAR(summary.total.rms, std::sqrt(6 * 25.0 / 200), 1e-6);
+
+  // Every outlier is on an even key, so camera 0
+  ASSERT_EQ(summary.perCamera.size(), 2u);
+  EXPECT_EQ(summary.perCamera.at(0).outliers, 6u);
+  EXPECT_EQ(summary.perCamera.at(1).outliers, 0u);
+  EXPECT_NEAR(summary.perCamera.at(1).rms, 0, 1e-9);
+
+  ASSERT_EQ(summary.perTag.size(), 3u);
+  size_t tagCorners = 0;
+  for (const auto &[tag, stats] : summary.perTag) {
+    tagCorners += stats.corners;
+  }
+  EXPECT_EQ(tagCorners, 200u);
+}
+
+TEST(ReprojectionDiagnosticsTest, PruneAndClear) {
+  ReprojectionDiagnostics diagnostics;
+  for (Key key = 1; key <= 10; key++) {
+    diagnostics.Add(key, 0, 1, kRobotTcamera, kWorldPcorners,
+                    Project(kTruth), Vector2{0.002, 0.002});
+  }
+  diagnostics.Prune(8);
+  EXPECT_EQ(diagnostics.NumObservations(), 3u);
+
+  // Compacted buffers still evaluate right
+  const auto summary = diagnostics.Evaluate(
+      [](Key) -> std::optional<Pose3> { return kTruth; });
+  EXPECT_EQ(summary.total.corners, 12u);
+  EXPECT_EQ(summary.total.outliers, 0u);
+
+  diagnostics.Clear();
+  EXPECT_EQ(diagnostics.NumObservations(), 0u);
+  EXPECT_EQ(diagnostics.Evaluate([](Key) -> std::optional<Pose3> {
+                         return kTruth;
+                       }).total.corners,
+            0u);
+}
+
+TEST(ReprojectionDiagnosticsTest, PrunesLateObservations) {
+  ReprojectionDiagnostics diagnostics;
+  // New vision on 10..14, with late frames for 3 and 4 showing up after
+  for (Key key : {10, 3, 11, 12, 4, 13, 14}) {
+    auto corners = Project(kTruth);
+    // Only the late ones are off, so anything stale left behind shows up
+    if (key < 10) {
+      corners[0].x() += 0.01;
+    }
+    diagnostics.Add(key, 0, 1, kRobotTcamera, kWorldPcorners, corners,
+                    Vector2{0.002, 0.002});
+  }
+
+  diagnostics.Prune(10);
+  EXPECT_EQ(diagnostics.NumObservations(), 5u);
+
+  std::vector<Key> evaluated;
+  const auto summary =
+      diagnostics.Evaluate([&](Key key) -> std::optional<Pose3> {
+        evaluated.push_back(key);
+        return kTruth;
+      });
+  EXPECT_EQ((std::vector<Key>{10, 11, 12, 13, 14}), evaluated);
+  EXPECT_EQ(summary.total.corners, 20u);
+  EXPECT_EQ(summary.total.outliers, 0u);
+}
@@ -0,0 +1,216 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <gtsam/linear/HessianFactor.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+#include "smoother_backend.h"
+#include "sparsify.h"
+
+using namespace gtsam;
+
+namespace {
+// Fold a whole graph into one dense marginal-style factor
+LinearContainerFactor Densify(const NonlinearFactorGraph &graph,
+                              const Values &values) {
+  const auto linear = graph.linearize(values);
+  return LinearContainerFactor{std::make_shared<HessianFactor>(*linear),
+                               values};
+}
+
+void ExpectSameMarginals(const NonlinearFactorGraph &a,
+                         const NonlinearFactorGraph &b, const Values &values,
+                         const KeyVector &keys) {
+  const Marginals marginalsA{a, values};
+  const Marginals marginalsB{b, values};
+  for (Key key : keys) {
+    EXPECT_TRUE(assert_equal(marginalsA.marginalCovariance(key),
+                             marginalsB.marginalCovariance(key), 1e-6));
+  }
+}
+} // namespace
+
+TEST(SparsifyTest, ChainComesBackExactly) {
+  Values values;
+  values.insert(1, Pose3{});
+  values.insert(2, Pose3{Rot3::Yaw(0.1), Point3{1, 0, 0}});
+  values.insert(3, Pose3{Rot3::Yaw(0.3), Point3{2, 0.2, 0}});
+
+  NonlinearFactorGraph graph;
+  graph.addPrior(1, values.at<Pose3>(1), noiseModel::Isotropic::Sigma(6, 0.1));
+  graph.emplace_shared<BetweenFactor<Pose3>>(
+      1, 2, values.at<Pose3>(1).between(values.at<Pose3>(2)),
+      noiseModel::Isotropic::Sigma(6, 0.05));
+  graph.emplace_shared<BetweenFactor<Pose3>>(
+      2, 3, values.at<Pose3>(2).between(values.at<Pose3>(3)),
+      noiseModel::Isotropic::Sigma(6, 0.02));
+
+  const NonlinearFactorGraph chain = SparsifyMarginal(Densify(graph, values));
+  ASSERT_EQ(chain.size(), 3u);
+  EXPECT_EQ(chain.at(0)->keys(), KeyVector({1}));
+  EXPECT_EQ(chain.at(1)->keys(), KeyVector({1, 2}));
+  EXPECT_EQ(chain.at(2)->keys(), KeyVector({2, 3}));
+
+  // Already a chain, so nothing is lost
+  ExpectSameMarginals(graph, chain, values, {1, 2, 3});
+  EXPECT_NEAR(chain.error(values), 0, 1e-9);
+}
+
+TEST(SparsifyTest, DenseBecomesChain) {
+  Values values;
+  for (int i = 0; i < 4; i++) {
+    values.insert(i, Pose2{i * 1.0, 0.1 * i, 0.05 * i});
+  }
+
+  // Every state connected to every other
+  NonlinearFactorGraph graph;
+  graph.addPrior(0, values.at<Pose2>(0), noiseModel::Isotropic::Sigma(3, 0.1));
+  for (int i = 0; i < 4; i++) {
+    for (int j = i + 1; j < 4; j++) {
+      graph.emplace_shared<BetweenFactor<Pose2>>(
+          i, j, values.at<Pose2>(i).between(values.at<Pose2>(j)),
+          noiseModel::Isotropic::Sigma(3, 0.05 * (j - i)));
+    }
+  }
+
+  const NonlinearFactorGraph chain = SparsifyMarginal(Densify(graph, values));
+  ASSERT_EQ(chain.size(), 4u);
+  for (size_t i = 1; i < chain.size(); i++) {
+    EXPECT_EQ(chain.at(i)->keys(), KeyVector({i - 1, i}));
+  }
+
+  // The oldest state keeps its marginal exactly, the rest are approximate
+  ExpectSameMarginals(graph, chain, values, {0});
+  EXPECT_NEAR(chain.error(values), 0, 1e-9);
+}
+
+TEST(SparsifyTest, RejectsMixedStates) {
+  Values values;
+  values.insert(1, Pose3{});
+  values.insert(2, Pose2{});
+
+  NonlinearFactorGraph graph;
+  graph.addPrior(1, Pose3{}, noiseModel::Isotropic::Sigma(6, 0.1));
+  graph.addPrior(2, Pose2{}, noiseModel::Isotropic::Sigma(3, 0.1));
+
+  EXPECT_TRUE(SparsifyMarginal(Densify(graph, values)).empty());
+}
+
+TEST(SparsifyTest, SmootherSwapsDenseMarginalForChain) {
+  const auto sparse = MakeSmootherBackend(
+      "isam2", 10, Isam2Config{.sparsifyMarginals = true});
+  const auto dense = MakeSmootherBackend("isam2", 10);
+
+  Values truth;
+  for (int i = 0; i < 8; i++) {
+    truth.insert(i, Pose3{Rot3::Yaw(0.1 * i), Point3{1.0 * i, 0.1 * i, 0}});
+  }
+  const auto between = [&](Key from, Key to, double sigma) {
+    return std::make_shared<BetweenFactor<Pose3>>(
+        from, to, truth.at<Pose3>(from).between(truth.at<Pose3>(to)),
+        noiseModel::Isotropic::Sigma(6, sigma));
+  };
+
+  // States 0-2 are old, 3-5 stay in the window. Vision of one landmark ties
+  // each old state to a newer one, so marginalizing 0-2 couples all of 3-5
+  NonlinearFactorGraph factors;
+  Values values;
+  SmootherBackend::KeyTimestampMap times;
+  factors.addPrior(0, truth.at<Pose3>(0), noiseModel::Isotropic::Sigma(6, 0.1));
+  for (Key i = 0; i < 6; i++) {
+    values.insert(i, truth.at(i));
+    times[i] = i;
+    if (i > 0) {
+      factors.push_back(between(i - 1, i, 0.05));
+    }
+    if (i < 3) {
+      factors.push_back(between(i, i + 3, 0.2));
+    }
+  }
+
+  const auto step = [&](Key key, double time) {
+    for (const auto &backend : {sparse.get(), dense.get()}) {
+      NonlinearFactorGraph newFactors;
+      newFactors.push_back(between(key - 1, key, 0.05));
+      Values newValues;
+      newValues.insert(key, truth.at(key));
+      backend->Update(newFactors, newValues, {{key, time}}, {});
+    }
+  };
+  for (const auto &backend : {sparse.get(), dense.get()}) {
+    backend->Update(factors, values, times, {});
+  }
+
+  // Pushes 0-2 out of the window, leaving one marginal over 3-5
+  step(6, 12.5);
+  const auto findDense = [&] {
+    size_t found = 0;
+    for (const auto &factor : sparse->Factors()) {
+      if (std::dynamic_pointer_cast<LinearContainerFactor>(factor) &&
+          factor->size() >= 3) {
+        KeyVector keys = factor->keys();
+        std::sort(keys.begin(), keys.end());
+        EXPECT_EQ(keys, KeyVector({3, 4, 5}));
+        found++;
+      }
+    }
+    return found;
+  };
+  EXPECT_EQ(findDense(), 1u);
+
+  // Nothing new leaves, so the next update just swaps in the chain
+  step(7, 12.6);
+  EXPECT_EQ(findDense(), 0u);
+  size_t priors = 0;
+  std::map<KeyVector, size_t> betweens;
+  for (const auto &factor : sparse->Factors()) {
+    if (!factor) {
+      continue;
+    }
+    EXPECT_LT(factor->size(), 3u);
+    if (std::dynamic_pointer_cast<PriorFactor<Pose3>>(factor)) {
+      EXPECT_EQ(factor->keys(), KeyVector({3}));
+      priors++;
+    }
+    if (std::dynamic_pointer_cast<BetweenFactor<Pose3>>(factor)) {
+      betweens[factor->keys()]++;
+    }
+  }
+  EXPECT_EQ(priors, 1u);
+  // Odometry, plus the chain alongside it
+  EXPECT_EQ(betweens[KeyVector({3, 4})], 2u);
+  EXPECT_EQ(betweens[KeyVector({4, 5})], 2u);
+  EXPECT_EQ(betweens[KeyVector({5, 6})], 1u);
+
+  // Noiseless, so the approximation doesn't move anything
+  EXPECT_TRUE(assert_equal(dense->CalculateEstimate(),
+                           sparse->CalculateEstimate(), 1e-6));
+}
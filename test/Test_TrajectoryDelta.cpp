@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "trajectory_delta.h"
+
+namespace {
+Timestamped<frc::Pose3d> PoseAt(uint64_t timeUs, double x) {
+  return {timeUs, frc::Pose3d{frc::Translation3d{units::meter_t{x},
+                                                 units::meter_t{0},
+                                                 units::meter_t{0}},
+                              frc::Rotation3d{}}};
+}
+} // namespace
+
+TEST(TrajectoryDeltaTest, DeltasOnlyCarryChanges) {
+  TrajectoryConfig config;
+  config.keyframeInterval = 100;
+  TrajectoryDeltaEncoder encoder{config};
+  TrajectoryDeltaDecoder decoder;
+
+  std::vector<Timestamped<frc::Pose3d>> history;
+  for (uint64_t i = 0; i < 10; i++) {
+    history.push_back(PoseAt(i * 1000, i));
+  }
+
+  // First message is a keyframe with everything
+  auto msg = encoder.Encode(history);
+  EXPECT_EQ(msg.size(), trajectory_delta::kHeaderSize +
+                            10 * trajectory_delta::kEntrySize);
+  ASSERT_TRUE(decoder.Decode(msg));
+  EXPECT_EQ(decoder.Trajectory().size(), 10u);
+
+  // Drop the oldest, append one, nudge one a little and one a lot
+  history.erase(history.begin());
+  history.push_back(PoseAt(10 * 1000, 10));
+  history[2] = PoseAt(history[2].time, 3.001);
+  history[4] = PoseAt(history[4].time, 6);
+
+  msg = encoder.Encode(history);
+  EXPECT_EQ(msg.size(), trajectory_delta::kHeaderSize +
+                            2 * trajectory_delta::kEntrySize);
+  ASSERT_TRUE(decoder.Decode(msg));
+
+  ASSERT_EQ(decoder.Trajectory().size(), 10u);
+  EXPECT_EQ(decoder.Trajectory().begin()->first, 1000u);
+  EXPECT_DOUBLE_EQ(decoder.Trajectory().at(5000).X().value(), 6);
+  EXPECT_DOUBLE_EQ(decoder.Trajectory().at(3000).X().value(), 3);
+  EXPECT_DOUBLE_EQ(decoder.Trajectory().at(10000).X().value(), 10);
+}
+
+TEST(TrajectoryDeltaTest, LateSubscriberWaitsForKeyframe) {
+  TrajectoryConfig config;
+  config.keyframeInterval = 3;
+  TrajectoryDeltaEncoder encoder{config};
+  TrajectoryDeltaDecoder decoder;
+
+  std::vector<Timestamped<frc::Pose3d>> history{PoseAt(0, 0)};
+
+  // Miss the first keyframe
+  encoder.Encode(history);
+
+  history.push_back(PoseAt(1000, 1));
+  EXPECT_FALSE(decoder.Decode(encoder.Encode(history)));
+  history.push_back(PoseAt(2000, 2));
+  EXPECT_FALSE(decoder.Decode(encoder.Encode(history)));
+  EXPECT_FALSE(decoder.Synced());
+
+  // Message 3 is a keyframe
+  EXPECT_TRUE(decoder.Decode(encoder.Encode(history)));
+  EXPECT_TRUE(decoder.Synced());
+  EXPECT_EQ(decoder.Trajectory().size(), 3u);
+}
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "worker_pool.h"
+
+TEST(WorkerPoolTest, RunsEveryIndexOnce) {
+  WorkerPool pool(4);
+
+  std::vector<std::atomic<int>> hits(100);
+  pool.ParallelFor(hits.size(), [&hits](size_t i) { hits[i]++; });
+
+  for (const auto &h : hits) {
+    EXPECT_EQ(1, h.load());
+  }
+}
+
+TEST(WorkerPoolTest, RunsThreadStartOnWorkers) {
+  std::atomic<int> started{0};
+  {
+    WorkerPool pool(4, [&started] { started++; });
+    pool.ParallelFor(100, [](size_t) {});
+  }
+
+  // Not on the caller
+  EXPECT_EQ(3, started.load());
+}
+
+TEST(WorkerPoolTest, NestedDoesNotDeadlock) {
+  // Fewer threads than outer tasks, so inner loops have to make progress on
+  // their calling thread
+  WorkerPool pool(2);
+
+  std::atomic<int> sum{0};
+  pool.ParallelFor(6, [&](size_t i) {
+    pool.ParallelFor(5, [&](size_t j) { sum += i * j; });
+  });
+
+  EXPECT_EQ(15 * 10, sum.load());
+}
+
+TEST(WorkerPoolTest, RethrowsExceptions) {
+  WorkerPool pool(3);
+
+  EXPECT_THROW(pool.ParallelFor(10,
+                                [](size_t i) {
+                                  if (i == 7) {
+                                    throw std::runtime_error("oops");
+                                  }
+                                }),
+               std::runtime_error);
+}
+
+TEST(WorkerPoolTest, PostRunsOffTheCaller) {
+  std::atomic<int> ran{0};
+  std::thread::id ranOn;
+  {
+    WorkerPool pool(2);
+    pool.Post([&] {
+      ranOn = std::this_thread::get_id();
+      ran++;
+    });
+  }
+  // The pool finishes queued work before it goes away
+  EXPECT_EQ(1, ran.load());
+  EXPECT_NE(std::this_thread::get_id(), ranOn);
+
+  // No threads of our own, so it has to run inline
+  WorkerPool single(1);
+  single.Post([&] { ran++; });
+  EXPECT_EQ(2, ran.load());
+}
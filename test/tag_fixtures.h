@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) PhotonVision
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <gtsam/geometry/Point2.h>
+#include <gtsam/geometry/Point3.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/NoiseModel.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <frc/apriltag/AprilTagFieldLayout.h>
+
+#include "TagModel.h"
+#include "gtsam_utils.h"
+
+// Tags and perfect observations of them, shared by the tests
+
+// Camera looking straight out the front of the robot
+inline const gtsam::Pose3 kRobotTcamera{
+    gtsam::Rot3(0, 0, 1, -1, 0, 0, 0, -1, 0), gtsam::Point3{}};
+
+// A tag 1m up at (x, y), facing back down the x axis at the origin
+inline frc::AprilTag TagFacingOrigin(int id, double x, double y) {
+  return frc::AprilTag{
+      id, frc::Pose3d{frc::Translation3d{units::meter_t{x}, units::meter_t{y},
+                                         units::meter_t{1}},
+                      frc::Rotation3d{units::radian_t{0}, units::radian_t{0},
+                                      units::radian_t{M_PI}}}};
+}
+
+// One tag 5m in front of the origin
+inline frc::AprilTagFieldLayout OneTagLayout() {
+  return frc::AprilTagFieldLayout{
+      {TagFacingOrigin(1, 5, 0)}, units::meter_t{16}, units::meter_t{8}};
+}
+
+// Two tags 5m in front of the origin, 1m apart
+inline frc::AprilTagFieldLayout TwoTagLayout() {
+  return frc::AprilTagFieldLayout{
+      {TagFacingOrigin(1, 5, 0), TagFacingOrigin(2, 5, 1)},
+      units::meter_t{16},
+      units::meter_t{8}};
+}
+
+// What a camera at kRobotTcamera sees of a tag from worldTbody, no noise
+inline CameraVisionObservation
+Observe(const TagModel &model, int tagID, const gtsam::Pose3 &worldTbody,
+        uint64_t timeUs, const gtsam::SharedNoiseModel &noise) {
+  std::vector<gtsam::Point2> corners;
+  const gtsam::Pose3 worldTcamera = worldTbody * kRobotTcamera;
+  for (const gtsam::Point3 &worldPcorner : *model.WorldToCorners(tagID)) {
+    const gtsam::Point3 camPcorner = worldTcamera.transformTo(worldPcorner);
+    corners.emplace_back(camPcorner.x() / camPcorner.z(),
+                         camPcorner.y() / camPcorner.z());
+  }
+  return {timeUs, tagID, corners, kRobotTcamera, &noise};
+}